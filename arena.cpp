@@ -0,0 +1,71 @@
+#include "arena.h"
+#include <cstdlib>
+
+using namespace ast;
+using namespace std;
+
+
+ast_arena:: ast_arena(size_t chunk_size): cursor(NULL), chunk_end(NULL), chunk_size(chunk_size), used(0) {}
+
+ast_arena:: ~ast_arena() {
+
+    release();
+}
+
+void* ast_arena:: grow(size_t bytes, size_t alignment) {
+    /* the current chunk is full. Large requests get a chunk of their own and leave the current one open,
+     * everything else starts a new chunk */
+
+    size_t needed = bytes + alignment;
+    if(needed > chunk_size / 4 && cursor != NULL) {
+
+        char* chunk = static_cast<char*>(malloc(needed));
+        if(chunk == NULL) throw bad_alloc();
+        chunks.push_back(chunk);
+        used += bytes;
+        return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(chunk) + alignment - 1) & ~uintptr_t(alignment - 1));
+    }
+
+    size_t size = max(chunk_size,needed);
+    char* chunk = static_cast<char*>(malloc(size));
+    if(chunk == NULL) throw bad_alloc();
+    chunks.push_back(chunk);
+    cursor = chunk;
+    chunk_end = chunk + size;
+
+    return bump(bytes,alignment);
+}
+
+void* ast_arena:: do_allocate(size_t bytes, size_t alignment) {
+
+    return bump(bytes,alignment);
+}
+
+void ast_arena:: do_deallocate(void*, size_t, size_t) {
+
+    //individual blocks are never given back, a vector which grows simply leaves its old buffer behind
+}
+
+bool ast_arena:: do_is_equal(const pmr::memory_resource &other) const noexcept {
+
+    return this == &other;
+}
+
+void ast_arena:: release() {
+
+    for(auto chunk: chunks) free(chunk);
+    chunks.clear();
+    cursor = NULL;
+    chunk_end = NULL;
+    used = 0;
+}
+
+size_t ast_arena:: bytes_used() const {
+
+    return this->used;
+}
+
+size_t ast_arena:: chunk_count() const {
+
+    return this->chunks.size();
+}
@@ -0,0 +1,69 @@
+//arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ast {
+
+class ast_arena: public std::pmr::memory_resource {
+
+    /* bump allocator for the AST of one compilation unit. Memory is taken in chunks and only given back all at once,
+     * so dropping a tree costs one free per chunk. Nodes are never destructed: whatever they own has to be trivially
+     * destructible or come from the arena as well, which is why their vector members are std::pmr::vectors */
+
+    std::vector<char*> chunks;
+    char* cursor;
+    char* chunk_end;
+    size_t chunk_size;
+    size_t used;
+
+    void* grow(size_t bytes, size_t alignment);
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    public:
+    ast_arena(size_t chunk_size = 1 << 16);
+    ast_arena(const ast_arena &) = delete;
+    ast_arena& operator=(const ast_arena &) = delete;
+    ~ast_arena();
+
+    void release(); //drops every node allocated so far
+    size_t bytes_used() const;
+    size_t chunk_count() const;
+
+    //the parser allocates every node through here, so the fast path is inlined
+    void* bump(size_t bytes, size_t alignment) {
+
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~uintptr_t(alignment - 1));
+        if(cursor == NULL || aligned + bytes > chunk_end) return grow(bytes,alignment);
+
+        cursor = aligned + bytes;
+        used += bytes;
+        return aligned;
+    }
+
+    template<class node_type, class... argument_types>
+    node_type* make(argument_types&&... arguments) {
+
+        return new (bump(sizeof(node_type),alignof(node_type))) node_type(std::forward<argument_types>(arguments)...);
+    }
+
+    //exact size copy of a vector the parser collected, for the vector members of nodes
+    template<class element_type>
+    std::pmr::vector<element_type> copy(const std::vector<element_type> &elements) {
+
+        return std::pmr::vector<element_type>(elements.begin(),elements.end(),this);
+    }
+
+};
+
+}
+
+#endif
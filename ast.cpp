@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include<iomanip>
@@ -12,44 +13,45 @@ using namespace tok;
 
 
 //CONSTRUCTORS
-print_statement:: print_statement(expression *exp,int line_number): exp(exp),statement(line_number) {};
-expression_statement:: expression_statement(expression *exp,int line_number): statement(line_number),exp(exp) {};
-declaration_statement:: declaration_statement(expression *exp,token variable_name,token_type variable_type,int line_number): statement(line_number), exp(exp),variable_name(variable_name), variable_type(variable_type) {};
-conditional_statement:: conditional_statement(expression *expr, statement* if_statements, statement* else_statements,int line_number): statement(line_number),expr(expr), if_statements(if_statements),else_statements(else_statements) {};
-block_statement:: block_statement(vector<statement*> &statements,int line_number): statement(line_number),statements(statements) {};
-while_statement:: while_statement(expression* expr, statement* statements,int line_number): statement(line_number),expr(expr), statements(statements) {};
-for_statement:: for_statement(statement *part1, expression *part2, expression* part3,statement* statements,int line_number): statement(line_number),part1(part1), part2(part2), part3(part3), statements(statements) {};
-function_call_expression:: function_call_expression(token function_name,vector<expression*> &arguments,int line_number): expression(line_number),function_name(function_name), arguments(arguments) {};
-function_declaration_statement::function_declaration_statement(tok::token function_name, vector<pair<tok::token,tok::token_type>> &parameters, statement* block,token_type return_type,int line_number): statement(line_number),function_name(function_name), parameters(parameters), block(block), return_type(return_type) {};
-return_statement:: return_statement(expression *return_exp,int line_number): statement(line_number),return_exp(return_exp) {};
-class_declaration_statement:: class_declaration_statement(tok:: token variable_name, std:: vector<statement*> methods,int line_number): statement(line_number),variable_name(variable_name), methods(methods) {}
-input_statement:: input_statement(token input_reciever_variable,token_type input_type,int line_number): statement(line_number),input_reciever_variable(input_reciever_variable), input_type(input_type) {};
-expression:: expression(int line_number): line_number(line_number) {};
-statement:: statement(int line_number): line_number(line_number) {};
-binary_expression:: binary_expression(expression *left, token& optr, expression *right,int line_number): left(left), optr(optr), right(right), expression(line_number) {}
-unary_expression:: unary_expression(token &optr,expression *right,int line_number): optr(optr),right(right),expression(line_number) {}
-logical_expression:: logical_expression(expression *left, token&optr, expression *right,int line_number): binary_expression(left,optr,right,line_number) {}
-literal_expression:: literal_expression(token &literal,int line_number): literal(literal), expression(line_number) {}
-variable_literal_expression:: variable_literal_expression(token  &variable_name,int line_number): variable_name(variable_name), expression(line_number) {}
-
-void binary_expression:: print_expression() {
+print_statement:: print_statement(expression *exp,int line_number): exp(exp),statement(PRINT_NODE,line_number) {};
+expression_statement:: expression_statement(expression *exp,int line_number): statement(EXPRESSION_STATEMENT_NODE,line_number),exp(exp) {};
+declaration_statement:: declaration_statement(expression *exp,token variable_name,token_type variable_type,int line_number): statement(DECLARATION_NODE,line_number), exp(exp),variable_name(variable_name), variable_type(variable_type) {};
+conditional_statement:: conditional_statement(expression *expr, statement* if_statements, statement* else_statements,int line_number): statement(CONDITIONAL_NODE,line_number),expr(expr), if_statements(if_statements),else_statements(else_statements) {};
+block_statement:: block_statement(pmr::vector<statement*> statements,int line_number,uint32_t begin,uint32_t end): statement(BLOCK_NODE,line_number),statements(std::move(statements)),begin(begin),end(end) {};
+while_statement:: while_statement(expression* expr, statement* statements,int line_number): statement(WHILE_NODE,line_number),expr(expr), statements(statements) {};
+for_statement:: for_statement(statement *part1, expression *part2, expression* part3,statement* statements,int line_number): statement(FOR_NODE,line_number),part1(part1), part2(part2), part3(part3), statements(statements) {};
+function_call_expression:: function_call_expression(token function_name,pmr::vector<expression*> arguments,int line_number): expression(CALL_NODE,line_number),function_name(function_name), arguments(std::move(arguments)) {};
+function_declaration_statement::function_declaration_statement(tok::token function_name, pmr::vector<pair<tok::token,tok::token_type>> parameters, statement* block,token_type return_type,int line_number): statement(FUNCTION_NODE,line_number),function_name(function_name), parameters(std::move(parameters)), block(block), return_type(return_type) {};
+return_statement:: return_statement(expression *return_exp,int line_number): statement(RETURN_NODE,line_number),return_exp(return_exp) {};
+class_declaration_statement:: class_declaration_statement(tok:: token variable_name, std::pmr::vector<statement*> methods,int line_number): statement(CLASS_NODE,line_number),variable_name(variable_name), methods(std::move(methods)) {}
+input_statement:: input_statement(token input_reciever_variable,token_type input_type,int line_number): statement(INPUT_NODE,line_number),input_reciever_variable(input_reciever_variable), input_type(input_type) {};
+ast_node:: ast_node(node_kind kind): kind(kind) {};
+expression:: expression(node_kind kind, int line_number): ast_node(kind), line_number(line_number), expression_type(tok::ERROR) {};
+statement:: statement(node_kind kind, int line_number): ast_node(kind), line_number(line_number) {};
+binary_expression:: binary_expression(expression *left, token& optr, expression *right,int line_number): left(left), optr(optr), right(right), expression(BINARY_NODE,line_number) {}
+unary_expression:: unary_expression(token &optr,expression *right,int line_number): optr(optr),right(right),expression(UNARY_NODE,line_number) {}
+logical_expression:: logical_expression(expression *left, token&optr, expression *right,int line_number): binary_expression(left,optr,right,line_number) { this->kind = LOGICAL_NODE; }
+literal_expression:: literal_expression(token &literal,int line_number): literal(literal), expression(LITERAL_NODE,line_number) {}
+variable_literal_expression:: variable_literal_expression(token  &variable_name,int line_number): variable_name(variable_name), expression(VARIABLE_NODE,line_number) {}
+
+void binary_expression:: print_expression(const source_buffer &source) {
 
     cout<<"expr( ";
-    this->left->print_expression();
+    this->left->print_expression(source);
     cout<<", ";
-    this->optr.print_token();
+    this->optr.print_token(source);
     cout<<", ";
-    this->right->print_expression();
+    this->right->print_expression(source);
     cout<<" )";
 
 }
 
-void unary_expression:: print_expression() {
+void unary_expression:: print_expression(const source_buffer &source) {
 
     cout<<"expr( ";
-    this->optr.print_token();
+    this->optr.print_token(source);
     cout<<", ";
-    this->right->print_expression();
+    this->right->print_expression(source);
     cout<<" )";
 
 }
@@ -60,96 +62,41 @@ token variable_literal_expression:: get_variable_name() {
 
 }
 
-void variable_literal_expression:: print_expression() {
+void variable_literal_expression:: print_expression(const source_buffer &source) {
 
     cout<<"expr( ";
-    this->variable_name.print_token();
+    this->variable_name.print_token(source);
     cout<<" )";
 }
 
-void literal_expression:: print_expression() {
+void literal_expression:: print_expression(const source_buffer &source) {
 
     cout<<"expr( ";
-    this->literal.print_token();
+    this->literal.print_token(source);
     cout<<") ";
 
 }
 
-void function_call_expression:: print_expression() {};
-void logical_expression:: print_expression() {
+void function_call_expression:: print_expression(const source_buffer &source) {};
+void logical_expression:: print_expression(const source_buffer &source) {
 
     cout<<"expr( ";
-    this->left->print_expression();
+    this->left->print_expression(source);
     cout<<", ";
-    this->optr.print_token();
+    this->optr.print_token(source);
     cout<<", ";
-    this->right->print_expression();
+    this->right->print_expression(source);
     cout<<" )";
 
 }
 
-//ACCEPT implementation
-any conditional_statement:: accept(ast::visitor* vt) {
-    vt->visit_conditional_statement(this);
-    return 0;
-}
-any block_statement :: accept(ast::visitor* vt) {
-    vt->visit_block_statement(this);
-    return 0;
-}
-any while_statement :: accept(ast::visitor* vt) {
-    vt->visit_while_statement(this);
-    return 0;
-}
-any for_statement :: accept(ast::visitor* vt) {
-    vt->visit_for_statement(this);
-    return 0;
-}
-any expression_statement :: accept(ast::visitor* vt) {
-    vt->visit_expression_statement(this);
-    return 0;
-}
-any declaration_statement :: accept(ast::visitor* vt) {
-    vt->visit_declaration_statement(this);
-    return 0;
-}
-any print_statement :: accept(ast::visitor* vt) {
-    vt->visit_print_statement(this);
-    return 0;
-}
-any input_statement :: accept(ast::visitor* vt) {
-    vt->visit_input_statement(this);
-    return 0;
-}
-any return_statement :: accept(ast::visitor* vt) {
-    vt->visit_return_statement(this);
-    return 0;
-}
-any function_declaration_statement :: accept(ast::visitor* vt) {
-    vt->visit_function_declaration_statement(this);
-    return 0;
-}
-
-any binary_expression :: accept(visitor* vt) {
-    return  vt->visit_binary_expression(this);
-}
-any unary_expression ::  accept(visitor* vt) {
-    return  vt->visit_unary_expression(this);
-}
-any literal_expression :: accept(visitor* vt) {
-    return  vt->visit_literal_expression(this);
-}
-any logical_expression:: accept(visitor* vt) {
-    return  vt->visit_logical_expression(this);
-}
-any variable_literal_expression:: accept(visitor* vt) {
-    return  vt->visit_variable_literal_expression(this);
-}
-any class_declaration_statement:: accept(visitor* vt) {
-    return  0;
-}
-any function_call_expression:: accept(visitor* vt) {
-    return  vt->visit_function_call_expression(this);
-}
+uint32_t ast:: top_level_frame_size(const vector<statement*> &program) {
 
+    uint32_t size = 0;
+    for(auto stmt: program) {
 
+        if(stmt->kind == DECLARATION_NODE) size = max(size,static_cast<declaration_statement*>(stmt)->slot + 1);
+        if(stmt->kind == FUNCTION_NODE) size = max(size,static_cast<function_declaration_statement*>(stmt)->slot + 1);
+    }
+    return size;
+}
@@ -4,18 +4,55 @@
 #include <string>
 #include <vector>
 #include "environment.h"
-#include <any>
+#include "arena.h"
+#include "deep_stack.h"
+#include <cstdint>
+#include <memory_resource>
 
+class thread_pool;
 
 
 namespace ast {
 
-   class visitor;
+   typedef enum : uint8_t {
+        //one tag per concrete node type. Passes switch on it instead of calling virtual methods or checking typeid
+        BINARY_NODE,
+        LOGICAL_NODE,
+        UNARY_NODE,
+        LITERAL_NODE,
+        VARIABLE_NODE,
+        CALL_NODE,
+        EXPRESSION_STATEMENT_NODE,
+        PRINT_NODE,
+        RETURN_NODE,
+        DECLARATION_NODE,
+        INPUT_NODE,
+        BLOCK_NODE,
+        CONDITIONAL_NODE,
+        WHILE_NODE,
+        FOR_NODE,
+        FUNCTION_NODE,
+        CLASS_NODE
+
+   } node_kind;
+
+   class frame_slot {
+
+        /* where semantic_analyser found the binding of a name: depth frames out from the innermost one, at index slot.
+         * Every scope the analyser opens is a frame: the program, a function's parameters, a block and a for loop, whose
+         * body block shares the loop's frame */
+
+        public:
+        uint32_t depth = 0;
+        uint32_t slot = 0;
+
+    };
 
    class ast_node {
 
         public:
-        virtual std::any accept(visitor *v) = 0;
+        node_kind kind;
+        ast_node(node_kind kind);
 
     };
 
@@ -24,15 +61,15 @@ namespace ast {
         public:
         int line_number;
         tok::token_type expression_type; //STRING, NUMBER
-        virtual void print_expression() = 0; //pure virtual function
-        expression(int line_number);
+        virtual void print_expression(const tok::source_buffer &source) = 0; //pure virtual function
+        expression(node_kind kind, int line_number);
     };
 
     class statement : public ast_node {
 
         public:
         int line_number;
-        statement(int line_number);
+        statement(node_kind kind, int line_number);
 
     };
     class conditional_statement: public statement{
@@ -42,16 +79,17 @@ namespace ast {
           statement* if_statements;
           statement *else_statements;
           conditional_statement(expression *expr, statement*  if_statements, statement *else_statements,int line_number);
-          std::any accept(visitor *v);
 
 
     };
     class block_statement: public statement{
 
           public:
-          std::vector<statement*> statements;
-          block_statement(std:: vector<statement*> &statements,int line_number);
-          std::any accept(visitor *v);
+          std::pmr::vector<statement*> statements;
+          uint32_t begin; //source range from the opening brace to just past the closing one
+          uint32_t end;
+          uint32_t frame_size = 0; //variables the block declares
+          block_statement(std::pmr::vector<statement*> statements,int line_number,uint32_t begin = 0,uint32_t end = 0);
 
     };
     class while_statement: public statement{
@@ -60,7 +98,6 @@ namespace ast {
         expression *expr;
         statement *statements;
         while_statement(expression *expr, statement *statements,int line_number);
-        std::any accept(visitor *v);
 
 
     };
@@ -71,8 +108,8 @@ namespace ast {
         expression * part2; //the expression which is checked for truth value;
         expression * part3; //the operation done after every iteration of the loop
         statement * statements;
+        uint32_t frame_size = 0; //variables of the header and the body
         for_statement(statement *part1, expression *part2, expression* part3,statement* statements,int line_number);
-        std::any accept(visitor *v);
 
 
     };
@@ -83,7 +120,6 @@ namespace ast {
           public:
           expression *exp;
           expression_statement(expression *exp,int line_number);
-          std::any accept(visitor *v);
 
 
     };
@@ -93,8 +129,8 @@ namespace ast {
           expression *exp;
           tok:: token variable_name;
           tok:: token_type variable_type;
+          uint32_t slot = 0; //where the variable lives in the innermost frame
           declaration_statement(expression *exp,tok::token variable,tok::token_type variable_type,int line_number);
-          std::any accept(visitor *v);
 
 
     };
@@ -103,7 +139,6 @@ namespace ast {
           public:
           expression *exp;
           print_statement(expression *exp,int line_number);
-          std::any accept(visitor *v);
 
 
 
@@ -113,8 +148,8 @@ namespace ast {
          public:
          tok::token input_reciever_variable;
          tok::token_type input_type;
+         frame_slot binding;
          input_statement(tok::token input_reciever_variable,tok::token_type input_type,int line_number);
-         std::any accept(visitor *v);
 
 
     };
@@ -124,7 +159,6 @@ namespace ast {
           public:
           expression *return_exp;
           return_statement(expression *return_exp,int line_number);
-          std::any accept(visitor *v);
 
 
 
@@ -135,10 +169,11 @@ namespace ast {
           public:
           tok:: token function_name;
           tok:: token_type return_type;
-          std:: vector<std:: pair<tok::token,tok::token_type>> parameters;
+          std::pmr::vector<std:: pair<tok::token,tok::token_type>> parameters;
           statement* block;
-          function_declaration_statement(tok::token function_name, std:: vector<std:: pair<tok::token,tok::token_type>> &parameters, statement* block,tok::token_type return_type,int line_number);
-          std::any accept(visitor *v);
+          uint32_t slot = 0; //where the function lives in the frame around it
+          uint32_t frame_size = 0; //the parameters, the body block has a frame of its own
+          function_declaration_statement(tok::token function_name, std::pmr::vector<std:: pair<tok::token,tok::token_type>> parameters, statement* block,tok::token_type return_type,int line_number);
 
 
     };
@@ -151,8 +186,7 @@ namespace ast {
         tok::token optr;
         expression *right;
         binary_expression(expression *left, tok::token &optr, expression *right,int line_number);
-        void print_expression();
-        std::any accept(visitor *v);
+        void print_expression(const tok::source_buffer &source);
 
 
     };
@@ -160,8 +194,7 @@ namespace ast {
     class logical_expression : public binary_expression{
         public:
         logical_expression(expression *left, tok::token &optr, expression *right,int line_number);
-        void print_expression();
-        std::any accept(visitor *v);
+        void print_expression(const tok::source_buffer &source);
 
 
     };
@@ -173,8 +206,7 @@ namespace ast {
         tok::token optr;
         expression * right;
         unary_expression(tok::token &optr, expression *right,int line_number);
-        void print_expression();
-        std::any accept(visitor *v);
+        void print_expression(const tok::source_buffer &source);
 
 
     };
@@ -184,8 +216,7 @@ namespace ast {
         public:
         tok::token literal;
         literal_expression(tok:: token &literal,int line_number);
-        void print_expression();
-        std::any accept(visitor *v);
+        void print_expression(const tok::source_buffer &source);
 
     };
 
@@ -193,10 +224,10 @@ namespace ast {
 
         public:
         tok::token variable_name;
+        frame_slot binding;
         variable_literal_expression(tok:: token &variable_name,int line_number);
         tok:: token get_variable_name();
-        void print_expression();
-        std::any accept(visitor *v);
+        void print_expression(const tok::source_buffer &source);
 
     };
 
@@ -208,67 +239,104 @@ namespace ast {
 
         public:
         tok::token function_name;
-        std::vector<expression*> arguments;
-        function_call_expression(tok::token function_name, std::vector<expression*> &arguments,int line_number);
-        void print_expression();
-        std::any accept(visitor *v);
+        std::pmr::vector<expression*> arguments;
+        frame_slot binding; //of the called function
+        function_call_expression(tok::token function_name, std::pmr::vector<expression*> arguments,int line_number);
+        void print_expression(const tok::source_buffer &source);
 
 
     };
 
-    class group_expression : public expression{
-        public:
-        expression*  exp;
-        group_expression(expression* exp,int line_number);
-        void print_expression();
-    };
 
     class class_declaration_statement: public statement {
         public:
         tok:: token variable_name;
-        std::vector<statement*> methods;
-        class_declaration_statement(tok:: token variable_name, std:: vector<statement*> methods,int line_number);
-        std:: any accept(visitor* vt);
-        std:: any execute();
+        std::pmr::vector<statement*> methods;
+        class_declaration_statement(tok:: token variable_name, std::pmr::vector<statement*> methods,int line_number);
 
     };
 
-    class visitor {
-
-    public:
-    virtual void visit_conditional_statement(conditional_statement* stmt) = 0;
-    virtual void visit_block_statement(block_statement* stmt) = 0;
-    virtual void visit_while_statement(while_statement* stmt) = 0;
-    virtual void visit_for_statement(for_statement* stmt) = 0;
-    virtual void visit_expression_statement(expression_statement* stmt) = 0;
-    virtual void visit_declaration_statement(declaration_statement* stmt) = 0;
-    virtual void visit_print_statement(print_statement* stmt) = 0;
-    virtual void visit_input_statement(input_statement* stmt) = 0;
-    virtual void visit_return_statement(return_statement* stmt) = 0;
-    virtual void visit_function_declaration_statement(function_declaration_statement* stmt) = 0;
-
-    virtual std::any visit_binary_expression(binary_expression* exp) = 0;
-    virtual std::any visit_logical_expression(logical_expression *exp) = 0;
-    virtual std::any visit_unary_expression(unary_expression * exp) = 0;
-    virtual std::any visit_literal_expression(literal_expression *exp) = 0;
-    virtual std::any visit_variable_literal_expression(variable_literal_expression* exp) = 0;
-    virtual std::any visit_function_call_expression(function_call_expression * exp) = 0;
+    template<class pass, class expression_result, class statement_result = void>
+    class tree_visitor {
+
+        /* static visitor: dispatches on the kind tag and calls pass::visit_<node>() directly, so visits return plain
+         * values with no virtual call, std::any or RTTI on the way. A pass derives from tree_visitor<itself, ...>
+         * and defines a visit method for every node type. Visits go through deep_call, so trees of any depth can be walked */
+
+        public:
+        expression_result visit(expression* exp) {
+
+            return deep_call([&]() -> expression_result {
+
+                pass* self = static_cast<pass*>(this);
+                switch(exp->kind) {
+
+                    case BINARY_NODE: return self->visit_binary_expression(static_cast<binary_expression*>(exp));
+                    case LOGICAL_NODE: return self->visit_logical_expression(static_cast<logical_expression*>(exp));
+                    case UNARY_NODE: return self->visit_unary_expression(static_cast<unary_expression*>(exp));
+                    case LITERAL_NODE: return self->visit_literal_expression(static_cast<literal_expression*>(exp));
+                    case VARIABLE_NODE: return self->visit_variable_literal_expression(static_cast<variable_literal_expression*>(exp));
+                    default: return self->visit_function_call_expression(static_cast<function_call_expression*>(exp));
+                }
+            });
+        }
+
+        statement_result visit(statement* stmt) {
+
+            return deep_call([&]() -> statement_result {
+
+                pass* self = static_cast<pass*>(this);
+                switch(stmt->kind) {
+
+                    case EXPRESSION_STATEMENT_NODE: return self->visit_expression_statement(static_cast<expression_statement*>(stmt));
+                    case PRINT_NODE: return self->visit_print_statement(static_cast<print_statement*>(stmt));
+                    case RETURN_NODE: return self->visit_return_statement(static_cast<return_statement*>(stmt));
+                    case DECLARATION_NODE: return self->visit_declaration_statement(static_cast<declaration_statement*>(stmt));
+                    case INPUT_NODE: return self->visit_input_statement(static_cast<input_statement*>(stmt));
+                    case BLOCK_NODE: return self->visit_block_statement(static_cast<block_statement*>(stmt));
+                    case CONDITIONAL_NODE: return self->visit_conditional_statement(static_cast<conditional_statement*>(stmt));
+                    case WHILE_NODE: return self->visit_while_statement(static_cast<while_statement*>(stmt));
+                    case FOR_NODE: return self->visit_for_statement(static_cast<for_statement*>(stmt));
+                    case FUNCTION_NODE: return self->visit_function_declaration_statement(static_cast<function_declaration_statement*>(stmt));
+                    default: return self->visit_class_declaration_statement(static_cast<class_declaration_statement*>(stmt));
+                }
+            });
+        }
 
     };
-    class semantic_analyser: public visitor {
+
+    //slots of the frame of the top level statements: every top level variable and function, where the analyser put them
+    uint32_t top_level_frame_size(const std::vector<statement*> &program);
+
+    typedef std::pair<bool,tok::token_type> expression_check; //whether an expression is well typed, and its type
+
+    class semantic_analyser: public tree_visitor<semantic_analyser,expression_check> {
 
 
         std::vector<ast:: statement*> ast;
+        const tok::source_buffer &source;
         symbol_table* symtab;
         void block_resolver(ast::block_statement* block);
         bool return_encountered;
+        std::vector<function_declaration_statement*> enclosing_functions; //whose bodies are being checked, innermost last
         std::string get_type_mismatch_error(expression *expr);
         int get_line_number(expression* expr);
+        std::vector<expression*> operator_chain; //explicit work stack of check_operator_chain
+        expression_check check_operator_chain(expression* exp);
+        expression_check check_operands(binary_expression* exp, expression_check left_result, expression_check right_result);
+        frame_slot locate(tok::token name); //the binding a name resolves to, the name must be declared
+        bool declare_function(function_declaration_statement* stmt); //false after reporting a redeclaration
+        void check_function_body(function_declaration_statement* stmt);
 
         public:
         std:: vector<std::string> error_stack;
-        semantic_analyser(std:: vector<ast:: statement*> ast);
+        uint32_t global_frame_size = 0; //top level variables and functions
+        semantic_analyser(std:: vector<ast:: statement*> ast, const tok::source_buffer &source);
+        semantic_analyser(const semantic_analyser &) = delete;
+        semantic_analyser& operator=(const semantic_analyser &) = delete;
+        ~semantic_analyser();
         void analyse_program();
+        void analyse_program_parallel(thread_pool &pool, size_t chunk_count); //the same diagnostics and annotations
         void visit_conditional_statement(conditional_statement* stmt);
         void visit_block_statement(block_statement* stmt);
         void visit_while_statement(while_statement* stmt);
@@ -279,13 +347,14 @@ namespace ast {
         void visit_input_statement(input_statement* stmt);
         void visit_return_statement(return_statement* stmt);
         void visit_function_declaration_statement(function_declaration_statement* stmt);
-
-        std::any visit_binary_expression(binary_expression* exp) ;
-        std::any visit_logical_expression(logical_expression *exp) ;
-        std::any visit_unary_expression(unary_expression * exp) ;
-        std::any visit_literal_expression(literal_expression *exp) ;
-        std::any visit_variable_literal_expression(variable_literal_expression* exp) ;
-        std::any visit_function_call_expression(function_call_expression * exp) ;
+        void visit_class_declaration_statement(class_declaration_statement* stmt);
+
+        expression_check visit_binary_expression(binary_expression* exp) ;
+        expression_check visit_logical_expression(logical_expression *exp) ;
+        expression_check visit_unary_expression(unary_expression * exp) ;
+        expression_check visit_literal_expression(literal_expression *exp) ;
+        expression_check visit_variable_literal_expression(variable_literal_expression* exp) ;
+        expression_check visit_function_call_expression(function_call_expression * exp) ;
 
 
 
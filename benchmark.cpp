@@ -0,0 +1,1219 @@
+#include "cache.h"
+#include "flat_ast.h"
+#include "incremental.h"
+#include "interpreter.h"
+#include "register_vm.h"
+#include "vm.h"
+#include "parser.h"
+#include "scanner.h"
+#include "simd_scan.h"
+#include "thread_pool.h"
+#include "token.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+using namespace scan;
+using namespace tok;
+
+/* front end benchmarks. Usage: alox_bench [suite] [size in MB]
+ * Every suite runs on a synthetic program which resembles our machine generated scripts */
+
+
+string generate_program(size_t target_bytes) {
+
+    string program;
+    program.reserve(target_bytes + 256);
+    int function_id = 0;
+
+    while(program.size() < target_bytes) {
+
+        string name = "function_" + to_string(function_id++);
+        program += "// generated function " + name + "\n";
+        program += "fun " + name + "(var: Number alpha, var: Number beta): Number {\n";
+        program += "    var: Number total = alpha * 2.5 + beta;\n";
+        program += "    var: String label = \"label for " + name + "\";\n";
+        program += "    for(var: Number i = 0; i < 100; i = i + 1) {\n";
+        program += "        if(total >= 1000 and i != 7) { total = total - i / 3; }\n";
+        program += "        else { total = total + 12.75; }\n";
+        program += "    }\n";
+        program += "    while(total > 0) { total = total - 1; print label; }\n";
+        program += "    return total;\n";
+        program += "}\n";
+        program += "print " + name + "(1, 2);\n";
+    }
+
+    return program;
+}
+
+string generate_expressions(size_t target_bytes) {
+    //statements made of long expressions which use every precedence level, parentheses, unary operators and calls
+
+    const char* operators[] = {" + ", " - ", " * ", " / ", " < ", " >= ", " == ", " != ", " and ", " or "};
+    const char* operands[] = {"alpha", "beta", "12.5", "-gamma", "!flag", "(alpha + 3)", "scale(beta, 2)", "\"text\"", "0x1F", "total"};
+    string program;
+    program.reserve(target_bytes + 256);
+    srand(11);
+
+    while(program.size() < target_bytes) {
+
+        program += rand() % 2 ? "print " : "total = ";
+        int length = 4 + rand() % 12;
+        for(int i = 0; i<length; i++) {
+
+            if(i > 0) program += operators[rand() % 10];
+            program += operands[rand() % 10];
+        }
+        program += ";\n";
+    }
+
+    return program;
+}
+
+double seconds_since(chrono::steady_clock::time_point begin) {
+
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+void bench_scan(size_t size_mb) {
+
+    source_buffer source(generate_program(size_mb << 20));
+    size_t token_count = 0;
+    int repetitions = 5;
+    double best = 1e100;
+
+    for(int i = 0; i<repetitions; i++) {
+
+        auto begin = chrono::steady_clock::now();
+        source.number_literals.clear();
+        scanner scan(source);
+        auto tokens = scan.scan_source_code();
+        best = min(best, seconds_since(begin));
+        token_count = tokens.size();
+    }
+
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    cout<<"scan: "<<megabytes<<" MB, "<<token_count<<" tokens, best of "<<repetitions<<": "<<best * 1000<<" ms, "<<megabytes / best<<" MB/s"<<endl;
+}
+
+bool kernels_match(const scan_kernels* kernels, const string &text, size_t begin, size_t end) {
+
+    const scan_kernels* reference = scalar_kernels();
+    int expected_newlines = 0, newlines = 0;
+
+    return kernels->find_newline(text.data(),begin,end) == reference->find_newline(text.data(),begin,end)
+        && kernels->find_string_end(text.data(),begin,end) == reference->find_string_end(text.data(),begin,end)
+        && kernels->skip_white_spaces(text.data(),begin,end,newlines) == reference->skip_white_spaces(text.data(),begin,end,expected_newlines)
+        && newlines == expected_newlines;
+}
+
+void bench_simd(size_t size_mb) {
+    /* differential check of every vector kernel against the scalar one on random buffers, from every start offset
+     * and with ends inside and at the edge of a vector block. Then the scanner is timed with each kernel set */
+
+    vector<const scan_kernels*> candidates;
+    if(sse2_kernels() != NULL) candidates.push_back(sse2_kernels());
+    if(avx2_kernels() != NULL) candidates.push_back(avx2_kernels());
+
+    const char alphabet[] = {' ',' ',' ','\n','\n','"','\0','a','/','\t'};
+    srand(42);
+    for(int round = 0; round<2000; round++) {
+
+        string text(rand() % 160, ' ');
+        int density = 1 + rand() % 10; //runs of blanks of varying length
+        for(auto &character: text) character = rand() % density == 0 ? alphabet[rand() % sizeof(alphabet)] : alphabet[rand() % 5];
+
+        for(size_t begin = 0; begin <= text.size(); begin++) {
+
+            size_t ends[] = {text.size(), begin + (text.size() - begin) / 2, min(text.size(),begin + 32), min(text.size(),begin + 15)};
+            for(auto kernels: candidates) {
+
+                for(size_t end: ends) {
+
+                    if(!kernels_match(kernels,text,begin,end)) {
+
+                        cout<<"simd: "<<kernels->name<<" kernels disagree with the scalar ones at ["<<begin<<", "<<end<<") of a "<<text.size()<<" byte buffer"<<endl;
+                        exit(1);
+                    }
+                }
+            }
+        }
+    }
+
+    cout<<"simd: "<<candidates.size()<<" vector kernel sets match the scalar kernels"<<endl;
+
+    //the vector kernels only pay off on trivia, so the generated program is indented and annotated like machine output
+    string program = generate_program(size_mb << 19);
+    string annotated = "";
+    size_t line_start = 0;
+    while(line_start < program.size()) {
+
+        size_t line_end = program.find('\n',line_start);
+        annotated += "                ";
+        annotated.append(program,line_start,line_end - line_start);
+        annotated += "  // generated from template block, do not edit this line by hand, see the generator\n";
+        line_start = line_end + 1;
+    }
+
+    source_buffer source(std::move(annotated));
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    const scan_kernels* selected = active_kernels();
+    candidates.insert(candidates.begin(),scalar_kernels());
+
+    for(auto kernels: candidates) {
+
+        use_kernels(kernels);
+        double best = 1e100;
+        for(int i = 0; i<5; i++) {
+
+            auto begin = chrono::steady_clock::now();
+            source.number_literals.clear();
+            scanner scan(source);
+            while(scan.next_token().type != END_OF_FILE);
+            best = min(best, seconds_since(begin));
+        }
+
+        cout<<"simd: scan with "<<kernels->name<<" kernels "<<megabytes / best<<" MB/s"<<endl;
+    }
+
+    use_kernels(selected);
+}
+
+bool same_tokens(const vector<token> &expected, const vector<token> &actual, const source_buffer &source) {
+
+    if(expected.size() != actual.size()) return false;
+    for(size_t i = 0; i<expected.size(); i++) {
+
+        const token &left = expected[i];
+        const token &right = actual[i];
+        if(left.type != right.type || left.offset != right.offset || left.length != right.length || left.line_number != right.line_number) return false;
+        if(left.type == IDENTIFIER && left.symbol_id != right.symbol_id) return false;
+        if(left.type == tok::NUMBER_TYPE && left.number_literal_value(source) != right.number_literal_value(source)) return false;
+    }
+
+    return true;
+}
+
+void bench_parallel_scan(size_t size_mb) {
+    /* checks that the chunked scanner reproduces the sequential token stream, also with one chunk per line,
+     * then measures it with growing thread counts */
+
+    source_buffer source(generate_program(size_mb << 20));
+    double megabytes = source.size() / (1024.0 * 1024.0);
+
+    auto begin = chrono::steady_clock::now();
+    scanner scan(source);
+    vector<token> expected = scan.scan_source_code();
+    double sequential = seconds_since(begin);
+
+    {
+        source_buffer small(generate_program(1 << 14));
+        scanner small_scan(small);
+        vector<token> small_expected = small_scan.scan_source_code();
+        thread_pool pool(4);
+        if(!same_tokens(small_expected,scan_source_code_parallel(small,pool,small.size()),small)) {
+
+            cout<<"parallel scan: one chunk per line differs from the sequential scan"<<endl;
+            exit(1);
+        }
+    }
+
+    cout<<"parallel scan: sequential "<<megabytes / sequential<<" MB/s"<<endl;
+    for(size_t threads = 1; threads <= max(4u,thread::hardware_concurrency()); threads *= 2) {
+
+        thread_pool pool(threads);
+        begin = chrono::steady_clock::now();
+        vector<token> tokens = scan_source_code_parallel(source,pool,threads * 4);
+        double elapsed = seconds_since(begin);
+
+        if(!same_tokens(expected,tokens,source)) {
+
+            cout<<"parallel scan: "<<threads<<" threads differ from the sequential scan"<<endl;
+            exit(1);
+        }
+
+        cout<<"parallel scan: "<<threads<<" threads "<<megabytes / elapsed<<" MB/s"<<endl;
+    }
+}
+
+void bench_parse(size_t size_mb) {
+    //scans and parses in one pass, the parser pulls its tokens from the scanner
+
+    source_buffer source(generate_program(size_mb << 20));
+
+    auto begin = chrono::steady_clock::now();
+    ast::ast_arena arena;
+    scanner scan(source);
+    parser p(scan,source,arena);
+    auto program = p.parse_program();
+    double elapsed = seconds_since(begin);
+
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    cout<<"parse: "<<megabytes<<" MB, "<<program.size()<<" top level declarations, "<<elapsed * 1000<<" ms, "<<megabytes / elapsed<<" MB/s"<<endl;
+
+    size_t arena_bytes = arena.bytes_used(), chunks = arena.chunk_count();
+    begin = chrono::steady_clock::now();
+    arena.release();
+    cout<<"parse: tree of "<<arena_bytes / (1024.0 * 1024.0)<<" MB in "<<chunks<<" arena chunks, released in "<<seconds_since(begin) * 1000<<" ms"<<endl;
+}
+
+void bench_expressions(size_t size_mb) {
+    //parsing on expression heavy input, where the operator precedence parser does most of the work
+
+    source_buffer source(generate_expressions(size_mb << 20));
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    double best = 1e100;
+    size_t statements = 0;
+
+    for(int i = 0; i<3; i++) {
+
+        auto begin = chrono::steady_clock::now();
+        ast::ast_arena arena;
+        scanner scan(source);
+        parser p(scan,source,arena);
+        statements = p.parse_program().size();
+        best = min(best, seconds_since(begin));
+
+        if(p.error_status) {
+
+            cout<<"expressions: the generated program does not parse: "<<p.errors[0]<<endl;
+            exit(1);
+        }
+    }
+
+    cout<<"expressions: "<<megabytes<<" MB, "<<statements<<" statements, best of 3: "<<best * 1000<<" ms, "<<megabytes / best<<" MB/s"<<endl;
+}
+
+class binding_checker: public ast::tree_visitor<binding_checker,void,void> {
+    /* replays the frames of an analysed program, each slot holding the symbol id declared into it, and checks that
+     * every resolved name finds its own symbol depth frames out at its slot */
+
+    vector<vector<uint32_t>> frames;
+
+    void declare(uint32_t slot, token name) {
+
+        if(slot >= frames.back().size()) valid = false;
+        else frames.back()[slot] = name.symbol_id;
+    }
+
+    void resolve(ast::frame_slot binding, token name) {
+
+        if(binding.depth >= frames.size()) { valid = false; return; }
+        auto &frame = frames[frames.size() - 1 - binding.depth];
+        if(binding.slot >= frame.size() || frame[binding.slot] != name.symbol_id) valid = false;
+    }
+
+    public:
+    bool valid = true;
+
+    bool check(const vector<ast::statement*> &program, uint32_t global_frame_size) {
+
+        frames.assign(1,vector<uint32_t>(global_frame_size,UINT32_MAX));
+        for(auto declaration: program) optional(declaration);
+        return valid;
+    }
+
+    void optional(ast::statement* stmt) { if(stmt != NULL) visit(stmt); }
+    void optional(ast::expression* exp) { if(exp != NULL) visit(exp); }
+
+    void visit_conditional_statement(ast::conditional_statement* stmt) { visit(stmt->expr); optional(stmt->if_statements); optional(stmt->else_statements); }
+    void visit_block_statement(ast::block_statement* stmt) {
+
+        frames.emplace_back(stmt->frame_size,UINT32_MAX);
+        for(auto inner: stmt->statements) optional(inner);
+        frames.pop_back();
+    }
+    void visit_while_statement(ast::while_statement* stmt) { visit(stmt->expr); optional(stmt->statements); }
+    void visit_for_statement(ast::for_statement* stmt) {
+        //the body block declares into the loop's frame
+
+        frames.emplace_back(stmt->frame_size,UINT32_MAX);
+        optional(stmt->part1);
+        optional(stmt->part2);
+        optional(stmt->part3);
+        if(stmt->statements->kind == ast::BLOCK_NODE) for(auto inner: static_cast<ast::block_statement*>(stmt->statements)->statements) optional(inner);
+        else visit(stmt->statements);
+        frames.pop_back();
+    }
+    void visit_expression_statement(ast::expression_statement* stmt) { visit(stmt->exp); }
+    void visit_declaration_statement(ast::declaration_statement* stmt) { declare(stmt->slot,stmt->variable_name); optional(stmt->exp); }
+    void visit_print_statement(ast::print_statement* stmt) { visit(stmt->exp); }
+    void visit_input_statement(ast::input_statement* stmt) { resolve(stmt->binding,stmt->input_reciever_variable); }
+    void visit_return_statement(ast::return_statement* stmt) { optional(stmt->return_exp); }
+    void visit_function_declaration_statement(ast::function_declaration_statement* stmt) {
+
+        declare(stmt->slot,stmt->function_name);
+        frames.emplace_back(stmt->frame_size,UINT32_MAX);
+        for(uint32_t i = 0; i<stmt->parameters.size(); i++) declare(i,stmt->parameters[i].first);
+        optional(stmt->block);
+        frames.pop_back();
+    }
+    void visit_class_declaration_statement(ast::class_declaration_statement* stmt) {}
+
+    void visit_binary_expression(ast::binary_expression* exp) { visit(exp->left); visit(exp->right); }
+    void visit_logical_expression(ast::logical_expression *exp) { visit(exp->left); visit(exp->right); }
+    void visit_unary_expression(ast::unary_expression * exp) { visit(exp->right); }
+    void visit_literal_expression(ast::literal_expression *exp) {}
+    void visit_variable_literal_expression(ast::variable_literal_expression* exp) { resolve(exp->binding,exp->variable_name); }
+    void visit_function_call_expression(ast::function_call_expression * exp) { resolve(exp->binding,exp->function_name); for(auto argument: exp->arguments) visit(argument); }
+
+};
+
+void bench_analyse(size_t size_mb) {
+    //semantic analysis alone, on an already parsed program
+
+    source_buffer source(generate_program(size_mb << 20));
+    ast::ast_arena arena;
+    scanner scan(source);
+    parser p(scan,source,arena);
+    auto program = p.parse_program();
+
+    auto begin = chrono::steady_clock::now();
+    ast::semantic_analyser analyser(program,source);
+    analyser.analyse_program();
+    double elapsed = seconds_since(begin);
+
+    if(!binding_checker().check(program,analyser.global_frame_size)) {
+
+        cout<<"analyse: a name resolved to the wrong frame slot"<<endl;
+        exit(1);
+    }
+
+    cout<<"analyse: "<<program.size()<<" top level declarations, "<<analyser.error_stack.size()<<" diagnostics, "<<elapsed * 1000<<" ms"<<endl;
+}
+
+void bench_parallel_analyse(size_t size_mb) {
+    /* the two phase analysis against the one pass analysis on a program with thousands of functions and with
+     * diagnostics sprinkled between them. Diagnostics and frame slots have to come out the same at every thread count */
+
+    string text = "var: Number early = 1;\n";
+    string generated = generate_program(size_mb << 20);
+    for(size_t offset = 0, i = 0; offset < generated.size(); i++) {
+
+        size_t next = generated.find("// generated",offset + 1);
+        if(next == string::npos) next = generated.size();
+        text.append(generated,offset,next - offset);
+        offset = next;
+
+        if(i % 5000 == 0) {
+
+            string suffix = to_string(i);
+            text += "fun uses_globals_" + suffix + "(): Number { print early; print late_" + suffix + "; return early; }\n";
+            text += "var: Number late_" + suffix + " = 2;\n";
+            text += "fun uses_globals_" + suffix + "(): Number { return 1; }\n";
+            text += "fun no_return_" + suffix + "(var: Number a): Number { var: Number b = a; }\n";
+            text += "fun mismatch_" + suffix + "(): Number { var: String s = \"x\"; input_number s; return s + 1; }\n";
+            text += "fun outer_" + suffix + "(): Void { fun inner(var: Number q): Number { return q + early; } print inner(late_" + suffix + "); }\n";
+            text += "fun shadowed_" + suffix + "(var: Number shadowed_" + suffix + "): Number { return 2; }\n"; //a parameter named like its function
+            text += "print uses_globals_" + suffix + "() + missing;\n";
+        }
+    }
+    source_buffer source(std::move(text));
+
+    auto parse = [&](ast::ast_arena &arena) {
+
+        scanner scan(source);
+        parser p(scan,source,arena);
+        return p.parse_program();
+    };
+
+    ast::ast_arena sequential_arena;
+    auto sequential_program = parse(sequential_arena);
+    auto begin = chrono::steady_clock::now();
+    ast::semantic_analyser sequential(sequential_program,source);
+    sequential.analyse_program();
+    double one_pass = seconds_since(begin);
+    ast::flat_tree expected = ast::flatten(sequential_program);
+
+    cout<<"parallel analyse: "<<sequential_program.size()<<" top level declarations, "<<sequential.error_stack.size()<<" diagnostics, one pass "<<one_pass * 1000<<" ms"<<endl;
+    for(size_t threads = 1; threads <= max(4u,thread::hardware_concurrency()); threads *= 2) {
+
+        ast::ast_arena arena;
+        auto program = parse(arena);
+        thread_pool pool(threads);
+        begin = chrono::steady_clock::now();
+        ast::semantic_analyser analyser(program,source);
+        analyser.analyse_program_parallel(pool,pool.size() * 4);
+        double elapsed = seconds_since(begin);
+
+        ast::flat_tree tree = ast::flatten(program);
+        if(analyser.error_stack != sequential.error_stack || analyser.global_frame_size != sequential.global_frame_size
+            || tree.depths != expected.depths || tree.slots != expected.slots || tree.extra != expected.extra || tree.expression_types != expected.expression_types) {
+
+            cout<<"parallel analyse: "<<threads<<" threads differ from the one pass analysis"<<endl;
+            exit(1);
+        }
+
+        cout<<"parallel analyse: "<<threads<<" threads "<<elapsed * 1000<<" ms"<<endl;
+    }
+}
+
+vector<double> tree_positions(const vector<ast::statement*> &program, const source_buffer &source) {
+    //every position and value of an AST, flattened so that two parses of the same text compare equal
+
+    vector<double> positions;
+    for(auto declaration: program) {
+
+        ast::visit_positions(declaration,
+            [&](token &t) {
+                positions.insert(positions.end(),{double(t.offset),double(t.length),double(t.type),double(t.line_number)});
+                if(t.type == IDENTIFIER) positions.push_back(t.symbol_id);
+                if(t.type == tok::NUMBER_TYPE) positions.push_back(t.number_literal_value(source));
+            },
+            [&](int &line_number) { positions.push_back(line_number); },
+            [&](uint32_t &offset) { positions.push_back(offset); });
+    }
+
+    return positions;
+}
+
+bool same_parse(const parsed_program &parallel, const vector<ast::statement*> &expected, const vector<string> &expected_errors, const source_buffer &source) {
+
+    if(parallel.errors != expected_errors) return false;
+    if(parallel.error_status) return true; //the trees of a broken program are never looked at
+    return tree_positions(parallel.declarations,source) == tree_positions(expected,source) && ast::flatten(parallel.declarations).kinds == ast::flatten(expected).kinds;
+}
+
+void bench_parallel_parse(size_t size_mb) {
+    /* checks that parsing top level declarations concurrently builds the sequential tree and reports the same errors,
+     * then measures it with growing thread counts. Both parse pre-scanned tokens so only the parse is timed */
+
+    vector<string> broken_programs = {
+        generate_program(1 << 14) + "print (1;\nfun f() { var: Number x = ; }\nprint 2;\n",
+        "if(1 < 2) { print 1; } else { print 2; }\nwhile(1 > 2) print 3;\nfor(var: Number i = 0; i < 3; i = i + 1) print i;\n",
+        generate_program(1 << 12) + "}\nprint 4;\n{ print 5;\n"
+    };
+
+    for(auto &text: broken_programs) {
+
+        source_buffer small(text);
+        scanner small_scan(small);
+        vector<token> small_tokens = small_scan.scan_source_code();
+
+        ast::ast_arena arena;
+        token_buffer stream(small_tokens);
+        parser p(stream,small,arena);
+        auto expected = p.parse_program();
+
+        thread_pool pool(4);
+        if(!same_parse(parse_program_parallel(small_tokens,small,pool,small_tokens.size()),expected,p.errors,small)) {
+
+            cout<<"parallel parse: one chunk per declaration differs from the sequential parse"<<endl;
+            exit(1);
+        }
+    }
+
+    source_buffer source(generate_program(size_mb << 20));
+    scanner scan(source);
+    vector<token> tokens = scan.scan_source_code();
+    double megabytes = source.size() / (1024.0 * 1024.0);
+
+    auto begin = chrono::steady_clock::now();
+    ast::ast_arena arena;
+    token_buffer stream(tokens);
+    parser p(stream,source,arena);
+    auto expected = p.parse_program();
+    double sequential = seconds_since(begin);
+
+    cout<<"parallel parse: "<<expected.size()<<" top level declarations, sequential "<<megabytes / sequential<<" MB/s"<<endl;
+    for(size_t threads = 1; threads <= max(4u,thread::hardware_concurrency()); threads *= 2) {
+
+        thread_pool pool(threads);
+        begin = chrono::steady_clock::now();
+        parsed_program program = parse_program_parallel(tokens,source,pool,threads * 4);
+        double elapsed = seconds_since(begin);
+
+        if(!same_parse(program,expected,p.errors,source)) {
+
+            cout<<"parallel parse: "<<threads<<" threads differ from the sequential parse"<<endl;
+            exit(1);
+        }
+
+        cout<<"parallel parse: "<<threads<<" threads "<<megabytes / elapsed<<" MB/s"<<endl;
+    }
+}
+
+void bench_incremental(size_t size_mb) {
+    /* random edits, checked against parsing the edited text from scratch. Then single edits in the middle of
+     * growing files: the cost should follow the size of the edited function, not of the file */
+
+    string fragments[] = {"", "1", " ", "x", "total", ";", "{", "}", "\n", "print 3;", "(", "// ", "\"", "var: Number q = 2;\n"};
+    srand(7);
+    for(int round = 0; round<20; round++) {
+
+        string text = generate_program(1 << 11);
+        incremental_parser document(text);
+
+        for(int i = 0; i<60; i++) {
+
+            size_t offset = rand() % (text.size() + 1);
+            size_t removed = min(text.size() - offset,size_t(rand() % 4));
+            string inserted = fragments[rand() % (sizeof(fragments) / sizeof(fragments[0]))];
+            text.replace(offset,removed,inserted);
+            document.edit(offset,removed,inserted);
+
+            source_buffer expected_source(text);
+            ast::ast_arena expected_arena;
+            scanner scan(expected_source);
+            parser p(scan,expected_source,expected_arena);
+            auto expected = p.parse_program();
+
+            bool same = p.errors == document.errors;
+            if(!p.error_status) same = same && tree_positions(expected,expected_source) == tree_positions(document.program(),document.get_source());
+            if(!same) {
+
+                cout<<"incremental: edit "<<i<<" of round "<<round<<" does not match a full parse"<<endl;
+                exit(1);
+            }
+        }
+    }
+
+    cout<<"incremental: random edits match full parses"<<endl;
+
+    {
+        //every re-parse leaves the replaced nodes in the arena, until enough of them make an edit re-parse everything
+        string text = generate_program(1 << 11);
+        incremental_parser document(text);
+        size_t digit = text.find("2.5"), full_parses = 0;
+        int edits = 20000;
+        for(int i = 0; i<edits; i++) {
+
+            string inserted = i % 2 ? "2" : "3";
+            text.replace(digit,1,inserted);
+            document.edit(digit,1,inserted);
+            full_parses += document.reparsed_bytes == text.size();
+        }
+
+        source_buffer expected_source(text);
+        ast::ast_arena expected_arena;
+        scanner scan(expected_source);
+        parser p(scan,expected_source,expected_arena);
+        if(full_parses == 0 || tree_positions(p.parse_program(),expected_source) != tree_positions(document.program(),document.get_source())) {
+
+            cout<<"incremental: "<<edits<<" edits in one block made "<<full_parses<<" full parses, or left a tree which does not match a full parse"<<endl;
+            exit(1);
+        }
+        cout<<"incremental: "<<edits<<" edits in one block reclaimed the arena with "<<full_parses<<" full parses"<<endl;
+    }
+
+    for(size_t megabytes = 1; megabytes <= size_mb; megabytes *= 4) {
+
+        string text = generate_program(megabytes << 20);
+        auto begin = chrono::steady_clock::now();
+        incremental_parser document(text);
+        double full = seconds_since(begin);
+
+        //an edit inside a loop body and one which adds a line, in the function in the middle of the file
+        size_t middle = text.find("total - i / 3",text.size() / 2);
+        int repetitions = 200;
+        size_t block_bytes = 0, line_bytes = 0;
+
+        begin = chrono::steady_clock::now();
+        for(int i = 0; i<repetitions; i++) {
+
+            document.edit(middle,1,i % 2 ? "total" : "t");
+            block_bytes = document.reparsed_bytes;
+        }
+        double in_block = seconds_since(begin) / repetitions;
+
+        begin = chrono::steady_clock::now();
+        for(int i = 0; i<repetitions; i++) {
+
+            if(i % 2) document.edit(middle,1,"");
+            else document.edit(middle,0,"\n");
+            line_bytes = document.reparsed_bytes;
+        }
+        double new_line = seconds_since(begin) / repetitions;
+
+        cout<<"incremental: "<<megabytes<<" MB, full parse "<<full * 1000<<" ms, edit in a block "<<in_block * 1e6<<" us ("<<block_bytes<<" bytes re-parsed), ";
+        cout<<"line break "<<new_line * 1e6<<" us ("<<line_bytes<<" bytes re-parsed)"<<endl;
+    }
+}
+
+class node_counter: public ast::tree_visitor<node_counter,void,void> {
+    //walks a pointer tree through the kind dispatch of tree_visitor, the way every pass over it does
+
+    public:
+    size_t nodes = 0;
+    void optional(ast::statement* stmt) { if(stmt != NULL) visit(stmt); }
+    void optional(ast::expression* exp) { if(exp != NULL) visit(exp); }
+
+    void visit_conditional_statement(ast::conditional_statement* stmt) { nodes++; visit(stmt->expr); optional(stmt->if_statements); optional(stmt->else_statements); }
+    void visit_block_statement(ast::block_statement* stmt) { nodes++; for(auto inner: stmt->statements) optional(inner); }
+    void visit_while_statement(ast::while_statement* stmt) { nodes++; visit(stmt->expr); optional(stmt->statements); }
+    void visit_for_statement(ast::for_statement* stmt) { nodes++; optional(stmt->part1); optional(stmt->part2); optional(stmt->part3); optional(stmt->statements); }
+    void visit_expression_statement(ast::expression_statement* stmt) { nodes++; visit(stmt->exp); }
+    void visit_declaration_statement(ast::declaration_statement* stmt) { nodes++; optional(stmt->exp); }
+    void visit_print_statement(ast::print_statement* stmt) { nodes++; visit(stmt->exp); }
+    void visit_input_statement(ast::input_statement* stmt) { nodes++; }
+    void visit_return_statement(ast::return_statement* stmt) { nodes++; optional(stmt->return_exp); }
+    void visit_function_declaration_statement(ast::function_declaration_statement* stmt) { nodes++; optional(stmt->block); }
+    void visit_class_declaration_statement(ast::class_declaration_statement* stmt) { nodes++; for(auto method: stmt->methods) optional(method); }
+
+    void visit_binary_expression(ast::binary_expression* exp) { nodes++; visit(exp->left); visit(exp->right); }
+    void visit_logical_expression(ast::logical_expression *exp) { nodes++; visit(exp->left); visit(exp->right); }
+    void visit_unary_expression(ast::unary_expression * exp) { nodes++; visit(exp->right); }
+    void visit_literal_expression(ast::literal_expression *exp) { nodes++; }
+    void visit_variable_literal_expression(ast::variable_literal_expression* exp) { nodes++; }
+    void visit_function_call_expression(ast::function_call_expression * exp) { nodes++; for(auto argument: exp->arguments) visit(argument); }
+
+};
+
+size_t count_flat_nodes(const ast::flat_tree &tree, uint32_t id) {
+
+    size_t nodes = 1;
+    tree.visit_children(id,[&](uint32_t child) { nodes += count_flat_nodes(tree,child); });
+    return nodes;
+}
+
+void bench_flat(size_t size_mb) {
+    /* memory and traversal time of the pointer tree against the flat one. The flat tree is checked by rebuilding
+     * pointer nodes from it and analysing both trees */
+
+    string text = generate_program(size_mb << 20);
+    text += "var: Number broken = \"text\" + 1;\nprint missing;\nfun f(var: Number a): Number { return a; }\nprint f(\"x\", 2);\n";
+    source_buffer source(std::move(text));
+    ast::ast_arena arena;
+    scanner scan(source);
+    parser p(scan,source,arena);
+    auto program = p.parse_program();
+    ast::semantic_analyser original_analyser(program,source);
+    original_analyser.analyse_program();
+
+    auto begin = chrono::steady_clock::now();
+    ast::flat_tree tree = ast::flatten(program);
+    double flattening = seconds_since(begin);
+
+    ast::ast_arena rebuilt_arena;
+    auto rebuilt = ast::unflatten(tree,rebuilt_arena);
+    ast::semantic_analyser rebuilt_analyser(rebuilt,source);
+    rebuilt_analyser.analyse_program();
+    ast::flat_tree reflattened = ast::flatten(rebuilt);
+
+    if(original_analyser.error_stack != rebuilt_analyser.error_stack || original_analyser.error_stack.size() != 4 || reflattened.kinds != tree.kinds
+        || reflattened.first != tree.first || reflattened.second != tree.second || reflattened.extra != tree.extra || reflattened.line_numbers != tree.line_numbers
+        || reflattened.depths != tree.depths || reflattened.slots != tree.slots) {
+
+        cout<<"flat: the tree rebuilt from the flat one differs from the parsed one"<<endl;
+        exit(1);
+    }
+
+    double pointer_walk = 1e100, flat_walk = 1e100, flat_scan = 1e100;
+    size_t pointer_nodes = 0, flat_nodes = 0, literal_nodes = 0;
+    for(int i = 0; i<5; i++) {
+
+        begin = chrono::steady_clock::now();
+        node_counter counter;
+        for(auto declaration: program) counter.optional(declaration);
+        pointer_walk = min(pointer_walk,seconds_since(begin));
+        pointer_nodes = counter.nodes;
+
+        begin = chrono::steady_clock::now();
+        flat_nodes = 0;
+        for(auto root: tree.roots) flat_nodes += count_flat_nodes(tree,root);
+        flat_walk = min(flat_walk,seconds_since(begin));
+
+        //passes which do not care about the order of the nodes just run over the columns
+        begin = chrono::steady_clock::now();
+        literal_nodes = count(tree.kinds.begin(),tree.kinds.end(),ast::LITERAL_NODE);
+        flat_scan = min(flat_scan,seconds_since(begin));
+    }
+
+    if(pointer_nodes != flat_nodes || flat_nodes != tree.size()) {
+
+        cout<<"flat: node counts differ, "<<pointer_nodes<<" pointer nodes and "<<flat_nodes<<" flat nodes"<<endl;
+        exit(1);
+    }
+
+    cout<<"flat: "<<tree.size()<<" nodes, pointer tree "<<arena.bytes_used() / double(tree.size())<<" bytes per node, flat tree "<<tree.bytes() / double(tree.size())<<" bytes per node, flattened in "<<flattening * 1000<<" ms"<<endl;
+    cout<<"flat: full walk of the pointer tree "<<pointer_walk * 1000<<" ms, of the flat tree "<<flat_walk * 1000<<" ms, scan of the kind column "<<flat_scan * 1000<<" ms ("<<literal_nodes<<" literals)"<<endl;
+}
+
+void bench_load(size_t size_mb) {
+    //compares the line by line loading of the old driver with mapping the file, both followed by a full scan
+
+    string path = "/tmp/alox_bench_load.alox";
+    {
+        ofstream program_file(path);
+        program_file<<generate_program(size_mb << 20);
+    }
+
+    auto begin = chrono::steady_clock::now();
+    {
+        ifstream source_code(path);
+        string text = "";
+        string line = "";
+        while(getline(source_code,line)) {
+            text += line;
+            text += '\n';
+        }
+        source_buffer source(std::move(text));
+        scanner scan(source);
+        scan.scan_source_code();
+    }
+    double streamed = seconds_since(begin);
+
+    begin = chrono::steady_clock::now();
+    {
+        int file = open(path.c_str(),O_RDONLY);
+        source_buffer source(file);
+        close(file);
+        scanner scan(source);
+        scan.scan_source_code();
+    }
+    double mapped = seconds_since(begin);
+
+    unlink(path.c_str());
+    cout<<"load+scan: getline "<<streamed * 1000<<" ms, mmap "<<mapped * 1000<<" ms"<<endl;
+}
+
+void bench_deep(size_t size_mb) {
+    /* programs nested size_mb * 64K levels deep, 1M at the default size. Every shape recurses somewhere else in the
+     * parser and the passes, all of them have to get through on stack segments */
+
+    size_t levels = size_mb << 16;
+    auto repeat = [](const string &text, size_t count) {
+
+        string repeated;
+        repeated.reserve(text.size() * count);
+        for(size_t i = 0; i<count; i++) repeated += text;
+        return repeated;
+    };
+
+    vector<pair<string,string>> shapes = {
+        {"+ chain","print 1" + repeat(" + 1",levels) + ";\n"},
+        {"nested parentheses","print " + repeat("(",levels) + "1" + repeat(")",levels) + ";\n"},
+        {"right nested +","print " + repeat("1 + (",levels) + "1" + repeat(")",levels) + ";\n"},
+        {"unary chain","print " + repeat("- ",levels) + "1;\n"},
+        {"nested blocks",repeat("{ ",levels) + "print 1;" + repeat(" }",levels) + "\n"},
+        {"nested ifs",repeat("if(1 < 2) ",levels) + "print 1;\n"}
+    };
+
+    for(auto &shape: shapes) {
+
+        source_buffer source(shape.second);
+        ast::ast_arena arena;
+
+        auto begin = chrono::steady_clock::now();
+        scanner scan(source);
+        parser p(scan,source,arena);
+        auto program = p.parse_program();
+        double parsing = seconds_since(begin);
+
+        begin = chrono::steady_clock::now();
+        ast::semantic_analyser analyser(program,source);
+        analyser.analyse_program();
+        double analysis = seconds_since(begin);
+
+        begin = chrono::steady_clock::now();
+        ast::flat_tree tree = ast::flatten(program);
+        ast::ast_arena rebuilt_arena;
+        auto rebuilt = ast::unflatten(tree,rebuilt_arena);
+        double round_trip = seconds_since(begin);
+
+        if(p.error_status || !analyser.error_stack.empty() || tree_positions(rebuilt,source) != tree_positions(program,source)) {
+
+            cout<<"deep: "<<shape.first<<" did not parse, analyse and flatten cleanly"<<endl;
+            exit(1);
+        }
+
+        cout<<"deep: "<<levels<<" levels of "<<shape.first<<", parse "<<parsing * 1000<<" ms, analyse "<<analysis * 1000<<" ms, flatten and rebuild "<<round_trip * 1000<<" ms"<<endl;
+    }
+}
+
+void bench_scopes(size_t size_mb) {
+    /* name lookups from the bottom of deeply nested scopes, every scope declaring a variable of its own. A lookup
+     * should cost the same at any depth */
+
+    for(size_t depth: {8,512,8192}) {
+
+        string text = "var: Number global = 1;\n";
+        for(size_t i = 0; i<depth; i++) text += "{ var: Number local_" + to_string(i) + " = " + to_string(i) + ";\n";
+        size_t references = 0;
+        while(text.size() < (size_mb << 20)) {
+
+            text += "print global + local_0 + global * global;\n";
+            references += 4;
+        }
+        for(size_t i = 0; i<depth; i++) text += "}";
+
+        source_buffer source(std::move(text));
+        ast::ast_arena arena;
+        scanner scan(source);
+        parser p(scan,source,arena);
+        auto program = p.parse_program();
+
+        auto begin = chrono::steady_clock::now();
+        ast::semantic_analyser analyser(program,source);
+        analyser.analyse_program();
+        double elapsed = seconds_since(begin);
+
+        if(p.error_status || !analyser.error_stack.empty() || !binding_checker().check(program,analyser.global_frame_size)) {
+
+            cout<<"scopes: the nested program did not analyse cleanly"<<endl;
+            exit(1);
+        }
+
+        cout<<"scopes: "<<depth<<" nested scopes, "<<elapsed * 1e9 / references<<" ns per name reference"<<endl;
+    }
+}
+
+void bench_cache(size_t size_mb) {
+    /* cold start (scan, parse, analyse, then write the cache) against warm start (load the cache and rebuild the
+     * tree) of the same file. The warm tree, its types and its diagnostics have to match the cold ones */
+
+    string path = "/tmp/alox_bench_cache.alox";
+    string directory = "/tmp/alox_bench_cache";
+    {
+        ofstream program_file(path);
+        program_file<<generate_program(size_mb << 20)<<"var: Number broken = \"text\" + 1;\nprint missing;\n";
+    }
+
+    auto open_source = [&]() {
+
+        int file = open(path.c_str(),O_RDONLY);
+        auto source = make_unique<source_buffer>(file);
+        close(file);
+        return source;
+    };
+
+    ast::program_cache cache(directory);
+    auto begin = chrono::steady_clock::now();
+    auto cold_source = open_source();
+    ast::ast_arena cold_arena;
+    scanner scan(*cold_source);
+    parser p(scan,*cold_source,cold_arena);
+    auto cold_program = p.parse_program();
+    ast::semantic_analyser analyser(cold_program,*cold_source);
+    analyser.analyse_program();
+    double front_end = seconds_since(begin);
+
+    ast::cached_program cold;
+    cold.diagnostics = analyser.error_stack;
+    cold.tree = ast::flatten(cold_program);
+    bool stored = cache.store(*cold_source,cold);
+    double cold_start = seconds_since(begin);
+
+    begin = chrono::steady_clock::now();
+    auto warm_source = open_source();
+    ast::cached_program warm;
+    bool hit = cache.load(*warm_source,warm);
+    ast::ast_arena warm_arena;
+    auto warm_program = ast::unflatten(warm.tree,warm_arena);
+    double warm_start = seconds_since(begin);
+
+    source_buffer edited(string(cold_source->data(),cold_source->size()) + " ");
+    ast::cached_program stale;
+    if(!stored || !hit || cache.load(edited,stale) || warm.diagnostics != cold.diagnostics || warm.diagnostics.size() != 2
+        || tree_positions(warm_program,*warm_source) != tree_positions(cold_program,*cold_source) || ast::flatten(warm_program).expression_types != cold.tree.expression_types
+        || ast::flatten(warm_program).depths != cold.tree.depths || ast::flatten(warm_program).slots != cold.tree.slots || warm.tree.extra != cold.tree.extra
+        || warm.tree.first != cold.tree.first || warm.tree.second != cold.tree.second) {
+
+        cout<<"cache: the loaded program differs from the analysed one"<<endl;
+        exit(1);
+    }
+
+    size_t cache_bytes = 0;
+    for(auto &entry: filesystem::directory_iterator(directory)) cache_bytes += entry.file_size();
+
+    //files that are whole but could not have come from flatten: a node that is its own child, a token past the source
+    ast::cached_program cyclic = cold, overrun = cold, rejected;
+    size_t binary = find(cyclic.tree.kinds.begin(),cyclic.tree.kinds.end(),ast::BINARY_NODE) - cyclic.tree.kinds.begin();
+    cyclic.tree.first[binary] = binary;
+    overrun.tree.tokens[binary].offset = cold_source->size() + 1;
+    if(!cache.store(*cold_source,cyclic) || cache.load(*warm_source,rejected) || !cache.store(*cold_source,overrun) || cache.load(*warm_source,rejected)) {
+
+        cout<<"cache: a malformed file was loaded"<<endl;
+        exit(1);
+    }
+    filesystem::remove_all(directory);
+    unlink(path.c_str());
+
+    cout<<"cache: "<<cold_source->size() / (1024.0 * 1024.0)<<" MB of source, "<<cache_bytes / (1024.0 * 1024.0)<<" MB cached"<<endl;
+    cout<<"cache: cold start "<<cold_start * 1000<<" ms (front end "<<front_end * 1000<<" ms), warm start "<<warm_start * 1000<<" ms"<<endl;
+}
+
+string interpret(const string &text, double &elapsed, const string &engine = "interpreter", uint64_t* dispatches = NULL) {
+    /* the output of a program which has to get through the front end cleanly. engine is the interpreter or the stack
+     * or register VM, with threaded or switch dispatch. A VM run that counts its dispatches goes through the switch */
+
+    source_buffer source(text);
+    ast::ast_arena arena;
+    scanner scan(source);
+    parser p(scan,source,arena);
+    auto program = p.parse_program();
+    ast::semantic_analyser analyser(program,source);
+    if(!p.error_status) analyser.analyse_program();
+    if(p.error_status || !analyser.error_stack.empty()) return "front end error";
+
+    ostringstream out;
+    istringstream in("12\nwords\n");
+    bool registers = engine.rfind("register",0) == 0, threaded = engine.find("switch") == string::npos;
+    bytecode_program compiled;
+    register_program compiled_registers;
+    if(registers) compiled_registers = compile_registers(program,source);
+    else if(engine != "interpreter") compiled = compile_program(program,source);
+    auto begin = chrono::steady_clock::now();
+    try {
+
+        if(engine == "interpreter") {
+
+            ast::interpreter machine(source,out,in);
+            machine.run(program);
+        }
+        else if(registers) {
+
+            register_machine machine(compiled_registers,out,in);
+            machine.run(threaded,dispatches != NULL);
+            if(dispatches != NULL) *dispatches = machine.dispatches;
+        }
+        else {
+
+            virtual_machine machine(compiled,out,in);
+            machine.run(threaded,dispatches != NULL);
+            if(dispatches != NULL) *dispatches = machine.dispatches;
+        }
+    }
+    catch(string error) {
+
+        out<<error<<'\n';
+    }
+    elapsed = seconds_since(begin);
+    return out.str();
+}
+
+const vector<pair<string,string>> known_output_programs = {
+    {"print 1 + 2 * 3; print 10 / 4; print 0.1 + 0.2; print -(2 - 5); print 1 < 2; print !0;","7\n2.5\n0.30000000000000004\n3\n1\n1\n"},
+    {"var: String s = \"ab\"; s = s + \"cd\"; print s; print \"ab\" < \"b\";","abcd\n1\n"},
+    {"print 0 and 1; print 2 and 3; print 0 or 4; print nil; print true;","0\n3\n4\nnil\ntrue\n"},
+    {"fun fib(var: Number n): Number { if(n < 2) { return n; } return fib(n - 1) + fib(n - 2); } print fib(20);","6765\n"},
+    {"fun outer(var: Number a): Number { var: Number c = a; fun bump(var: Number by): Number { c = c + by; return c; } bump(2); return bump(3); } print outer(10);","15\n"},
+    {"var: Number x = 1; { var: Number x = 2; { var: Number y = x; print y; } print x; } print x;","2\n2\n1\n"},
+    {"var: Number t = 0; for(var: Number i = 0; i < 5; i = i + 1) { var: Number sq = i * i; t = t + sq; } print t; for(var: Number j = 0; j < 2; j = j + 1) print j;","30\n0\n1\n"},
+    {"fun first(var: Number n): Number { while(n > 0) { if(n == 3) { return n * 10; } n = n - 1; } return 0; } print first(8);","30\n"},
+    {"var: Number n = 0; var: String w = \"\"; input_number n; input_string w; print n + 1; print w; input_number n;","13\nwords\nRUNTIME ERROR at line 1 : no input left for \"n\"\n"},
+    {"fun f(): Void { print 1; } fun g(): Number { f(); return 2; } print g();","1\n2\n"},
+    {"var: Number x = 1; print x + (x = 3); fun outer(): Number { var: Number c = 1; fun bump(): Number { c = c + 10; return 1; } return c + bump(); } print outer();","4\n2\n"},
+    {"var: Number y = 0; y = 0 or 5; print y; var: Number b = 0; if(!b) print 7; else print 8; var: String s = \"b\"; while(s < \"bbbb\") s = s + \"b\"; print s;","5\n7\nbbbb\n"},
+    {"fun g(): Number { return 0; } fun make(var: Number v): Void { fun inner(): Number { return v; } g = inner; } make(42); fun other(var: Number a, var: Number b, var: Number c): Number { return a; } print other(7,8,9); print g();","front end error"}, //a nested function must not outlive its frame
+    {"print 1; if(1) { return 2; }","front end error"} //there is no function to return from
+};
+
+//recursion without a base case has to stop at max_call_depth with a run time error, not exhaust memory
+const pair<string,string> runaway_recursion = {"fun f(var: Number n): Number { return f(n + 1); } print f(0);","RUNTIME ERROR at line 1 : Stack overflow, calls nest deeper than " + to_string(max_call_depth) + "\n"};
+
+string fib_program(int depth) {
+
+    return "fun fib(var: Number n): Number { if(n < 2) { return n; } return fib(n - 1) + fib(n - 2); } print fib(" + to_string(depth) + ");";
+}
+
+double fib_calls(int depth) {
+
+    double calls = 0;
+    for(double a = 1, b = 1, i = 0; i<=depth; i++) { calls = a; double c = a + b; a = b; b = c; }
+    return 2 * calls - 1;
+}
+
+string loop_program(size_t iterations) {
+
+    return "var: Number t = 0; for(var: Number i = 0; i < " + to_string(iterations) + "; i = i + 1) { t = t + i * 2 - i / 4; } print t;";
+}
+
+void bench_interpret(size_t size_mb) {
+    /* the tree walking interpreter: programs with known output first, then throughput on calls, loops and the
+     * generated program. These are the baseline numbers for the faster engines */
+
+    auto programs = known_output_programs;
+    programs.push_back(runaway_recursion);
+    double elapsed;
+    for(auto &program: programs) {
+
+        string output = interpret(program.first,elapsed);
+        if(output != program.second) {
+
+            cout<<"interpret: \""<<program.first<<"\" printed \""<<output<<"\""<<endl;
+            exit(1);
+        }
+    }
+    cout<<"interpret: "<<programs.size()<<" programs print what they should"<<endl;
+
+    int depth = 25 + (size_mb >= 16);
+    string output = interpret(fib_program(depth),elapsed);
+    double calls = fib_calls(depth);
+    cout<<"interpret: fib("<<depth<<") = "<<output.substr(0,output.size() - 1)<<", "<<elapsed * 1000<<" ms, "<<calls / elapsed / 1e6<<" M calls/s"<<endl;
+
+    size_t iterations = size_mb << 18;
+    output = interpret(loop_program(iterations),elapsed);
+    cout<<"interpret: arithmetic loop of "<<iterations<<" iterations, "<<elapsed * 1000<<" ms, "<<iterations / elapsed / 1e6<<" M iterations/s"<<endl;
+
+    string generated = generate_program(size_mb << 14);
+    output = interpret(generated,elapsed);
+    cout<<"interpret: "<<generated.size() / 1024<<" KB generated program, "<<elapsed * 1000<<" ms, "<<output.size() / 1024<<" KB printed"<<endl;
+}
+
+void bench_vm(size_t size_mb) {
+    /* the bytecode VM under both dispatch loops against the interpreter: the known programs and the generated one have
+     * to print exactly what the interpreter prints, then the same call and loop workloads are timed on all three */
+
+    vector<string> engines = {"stack","stack_switch"};
+    if(!threaded_dispatch_available) engines.erase(engines.begin());
+
+    double elapsed;
+    string generated = generate_program(size_mb << 14);
+    string expected = interpret(generated,elapsed);
+    auto programs = known_output_programs;
+    programs.push_back(runaway_recursion);
+    for(auto &engine: engines) {
+
+        for(auto &program: programs) {
+
+            string output = interpret(program.first,elapsed,engine);
+            if(output != program.second) {
+
+                cout<<"vm: "<<engine<<", \""<<program.first<<"\" printed \""<<output<<"\""<<endl;
+                exit(1);
+            }
+        }
+        if(interpret(generated,elapsed,engine) != expected) {
+
+            cout<<"vm: "<<engine<<" prints something else than the interpreter for the generated program"<<endl;
+            exit(1);
+        }
+        cout<<"vm: "<<engine<<", "<<programs.size()<<" programs and "<<generated.size() / 1024<<" KB generated program print what the interpreter prints ("<<elapsed * 1000<<" ms)"<<endl;
+    }
+
+    int depth = 25 + (size_mb >= 16);
+    size_t iterations = size_mb << 18;
+    double interpreter_fib, interpreter_loop;
+    interpret(fib_program(depth),interpreter_fib);
+    interpret(loop_program(iterations),interpreter_loop);
+    cout<<"vm: interpreter fib("<<depth<<") "<<interpreter_fib * 1000<<" ms, loop of "<<iterations<<" "<<interpreter_loop * 1000<<" ms"<<endl;
+
+    for(auto &engine: engines) {
+
+        double fib, loop;
+        interpret(fib_program(depth),fib,engine);
+        interpret(loop_program(iterations),loop,engine);
+        cout<<"vm: "<<engine<<" fib "<<fib * 1000<<" ms ("<<fib_calls(depth) / fib / 1e6<<" M calls/s, "<<interpreter_fib / fib<<"x), loop "<<loop * 1000<<" ms ("<<iterations / loop / 1e6<<" M iterations/s, "<<interpreter_loop / loop<<"x)"<<endl;
+    }
+}
+
+void bench_registers(size_t size_mb) {
+    /* the register VM has to print what the interpreter prints, then both VMs run the same corpus twice: once
+     * counting dispatches, once timed with threaded dispatch, so the faster engine can be picked per workload */
+
+    double elapsed;
+    string generated = generate_program(size_mb << 14);
+    string expected = interpret(generated,elapsed);
+    auto programs = known_output_programs;
+    programs.push_back(runaway_recursion);
+    for(string engine: {"register","register_switch"}) {
+
+        for(auto &program: programs) {
+
+            string output = interpret(program.first,elapsed,engine);
+            if(output != program.second) {
+
+                cout<<"registers: "<<engine<<", \""<<program.first<<"\" printed \""<<output<<"\""<<endl;
+                exit(1);
+            }
+        }
+        if(interpret(generated,elapsed,engine) != expected) {
+
+            cout<<"registers: "<<engine<<" prints something else than the interpreter for the generated program"<<endl;
+            exit(1);
+        }
+    }
+    cout<<"registers: "<<programs.size()<<" programs and the generated one print what the interpreter prints"<<endl;
+
+    int depth = 25 + (size_mb >= 16);
+    size_t iterations = size_mb << 18;
+    vector<pair<string,string>> corpus = {{"fib(" + to_string(depth) + ")",fib_program(depth)},{"loop of " + to_string(iterations),loop_program(iterations)},{to_string(generated.size() / 1024) + " KB generated",generated}};
+    for(auto &workload: corpus) {
+
+        uint64_t stack_dispatches, register_dispatches;
+        double stack_time, register_time;
+        interpret(workload.second,elapsed,"stack",&stack_dispatches);
+        interpret(workload.second,elapsed,"register",&register_dispatches);
+        interpret(workload.second,stack_time,"stack");
+        interpret(workload.second,register_time,"register");
+        cout<<"registers: "<<workload.first<<": stack "<<stack_dispatches<<" dispatches "<<stack_time * 1000<<" ms, register "<<register_dispatches<<" dispatches "<<register_time * 1000<<" ms ("<<double(stack_dispatches) / register_dispatches<<"x fewer dispatches, "<<stack_time / register_time<<"x faster)"<<endl;
+    }
+}
+
+void bench_strings(size_t size_mb) {
+    /* String + in a loop, with and without reading the string after every append. Ropes keep an append amortized
+     * O(1) in both cases, so four times the appends should take about four times as long on every engine */
+
+    size_t appends = size_mb << 14;
+    for(string engine: {"interpreter","stack","register"}) {
+
+        for(bool read: {false,true}) {
+
+            double per_append[2];
+            for(int run = 0; run<2; run++) {
+
+                size_t count = appends << (2 * run);
+                string program = "var: String s = \"\"; for(var: Number i = 0; i < " + to_string(count) + "; i = i + 1) { s = s + \"ab\";" + (read ? " if(s < \"a\") print 0;" : "") + " } print s;";
+                double elapsed;
+                string output = interpret(program,elapsed,engine);
+                if(output.size() != 2 * count + 1) {
+
+                    cout<<"strings: "<<engine<<" printed "<<output.size()<<" characters instead of "<<2 * count + 1<<endl;
+                    exit(1);
+                }
+                per_append[run] = elapsed / count * 1e9;
+            }
+            cout<<"strings: "<<engine<<(read ? ", reading every time" : "")<<": "<<appends<<" appends "<<per_append[0]<<" ns each, "<<(appends << 2)<<" appends "<<per_append[1]<<" ns each"<<endl;
+        }
+    }
+
+    //equal literals share one interned object
+    string_table &table = interned_strings();
+    size_t before = table.size();
+    value a = table.intern("interned in the strings benchmark"), b = table.intern("interned in the strings benchmark");
+    if(a.text_object() != b.text_object() || table.size() != before + 1 || !a.equals(b)) {
+
+        cout<<"strings: interning made two objects for one string"<<endl;
+        exit(1);
+    }
+    cout<<"strings: interned literals share one object"<<endl;
+}
+
+int main(int argc, char** argv) {
+
+    vector<pair<string,function<void(size_t)>>> suites = {{"scan",bench_scan},{"simd",bench_simd},{"parallel_scan",bench_parallel_scan},{"parse",bench_parse},{"expressions",bench_expressions},{"parallel_parse",bench_parallel_parse},{"analyse",bench_analyse},{"parallel_analyse",bench_parallel_analyse},{"scopes",bench_scopes},{"incremental",bench_incremental},{"flat",bench_flat},{"load",bench_load},{"cache",bench_cache},{"deep",bench_deep},{"interpret",bench_interpret},{"vm",bench_vm},{"registers",bench_registers},{"strings",bench_strings}};
+
+    string selected = argc > 1 ? argv[1] : "all";
+    size_t size_mb = argc > 2 ? strtoul(argv[2],NULL,10) : 16;
+
+    bool ran = false;
+    for(auto &suite: suites) {
+
+        if(selected == "all" || selected == suite.first) {
+
+            suite.second(size_mb);
+            ran = true;
+        }
+    }
+
+    if(!ran) {
+
+        cout<<"Unknown benchmark suite \""<<selected<<"\""<<endl;
+        return 1;
+    }
+
+    return 0;
+}
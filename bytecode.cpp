@@ -0,0 +1,406 @@
+#include "bytecode.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+using namespace ast;
+using namespace std;
+using namespace tok;
+
+
+void line_table:: mark(uint32_t offset, int line_number) {
+
+    if(lines.empty() || lines.back().second != line_number) lines.push_back({offset,line_number});
+}
+
+int line_table:: line_of(uint32_t offset) const {
+
+    auto after = upper_bound(lines.begin(),lines.end(),make_pair(offset,INT_MAX));
+    return after == lines.begin() ? 0 : prev(after)->second;
+}
+
+void frame_layout:: open_scope(uint32_t size) {
+
+    scopes.push_back(scope_record{level,next_slot});
+    next_slot += size;
+}
+
+void frame_layout:: close_scope(uint32_t size) {
+
+    scopes.pop_back();
+    next_slot -= size;
+}
+
+uint32_t frame_layout:: enter_function() {
+
+    level++;
+    uint32_t outer_next_slot = next_slot;
+    next_slot = 0;
+    return outer_next_slot;
+}
+
+void frame_layout:: leave_function(uint32_t outer_next_slot) {
+
+    level--;
+    next_slot = outer_next_slot;
+}
+
+slot_address frame_layout:: locate(frame_slot binding) const {
+
+    const scope_record &scope = scopes[scopes.size() - 1 - binding.depth];
+    return slot_address{level - scope.level,scope.base + binding.slot,scope.level == 0 && level != 0};
+}
+
+uint32_t frame_layout:: declared(uint32_t slot) const {
+
+    return scopes.back().base + slot;
+}
+
+constant_pool:: constant_pool(vector<value> &constants): constants(constants) {}
+
+uint32_t constant_pool:: number(double literal) {
+
+    auto known = numbers.try_emplace(literal,constants.size());
+    if(known.second) constants.push_back(value(literal));
+    return known.first->second;
+}
+
+uint32_t constant_pool:: string(string_view literal) {
+
+    auto known = strings.try_emplace(literal,constants.size());
+    if(known.second) constants.push_back(interned_strings().intern(literal));
+    return known.first->second;
+}
+
+uint32_t operand_count(opcode op) {
+
+    switch(op) {
+
+        case OP_GET_OUTER: case OP_SET_OUTER: case OP_STORE_OUTER: return 2;
+        case OP_CONSTANT: case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_STORE_LOCAL: case OP_GET_GLOBAL: case OP_SET_GLOBAL: case OP_STORE_GLOBAL:
+        case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_JUMP_IF_FALSE_OR_POP: case OP_JUMP_IF_TRUE_OR_POP: case OP_CLOSURE: case OP_CALL:
+        case OP_INPUT_NUMBER: case OP_INPUT_STRING: return 1;
+        default: return 0;
+    }
+}
+
+int stack_effect(opcode op, uint32_t operand) {
+    //for the jumps which may pop, the effect on the path which falls through
+
+    switch(op) {
+
+        case OP_CONSTANT: case OP_NIL: case OP_TRUE: case OP_FALSE: case OP_GET_LOCAL: case OP_GET_GLOBAL: case OP_GET_OUTER:
+        case OP_CLOSURE: case OP_INPUT_NUMBER: case OP_INPUT_STRING: return 1;
+        case OP_SET_LOCAL: case OP_SET_GLOBAL: case OP_SET_OUTER: case OP_NEGATE: case OP_NOT: case OP_JUMP: return 0;
+        case OP_CALL: return -int(operand);
+        default: return -1;
+    }
+}
+
+
+typedef enum : uint8_t { GET_ACCESS, SET_ACCESS, STORE_ACCESS } slot_access; //the order of OP_GET_LOCAL, OP_SET_LOCAL, OP_STORE_LOCAL
+
+class bytecode_compiler: public tree_visitor<bytecode_compiler,void,void> {
+
+    //emits the code of one function at a time, with its blocks folded into its frame by layout
+
+    bytecode_program &program;
+    const source_buffer &source;
+    frame_layout layout;
+    constant_pool constants;
+    uint32_t function = 0; //index of the function being compiled
+    uint32_t stack_depth = 0;
+
+    compiled_function& chunk() { return program.functions[function]; }
+
+    void emit(opcode op, int line_number, uint32_t operand = 0, uint32_t second_operand = 0) {
+
+        compiled_function &code = chunk();
+        code.mark(code.code.size(),line_number);
+
+        code.code.push_back(op);
+        uint32_t operands[2] = {operand,second_operand};
+        for(uint32_t i = 0; i<operand_count(op); i++) {
+
+            uint8_t bytes[4];
+            memcpy(bytes,&operands[i],4);
+            code.code.insert(code.code.end(),bytes,bytes + 4);
+        }
+
+        stack_depth += stack_effect(op,operand);
+        code.max_stack = max(code.max_stack,stack_depth);
+    }
+
+    uint32_t emit_jump(opcode op, int line_number) {
+        //returns where the offset goes, for patch_jump
+
+        emit(op,line_number,0);
+        return chunk().code.size() - 4;
+    }
+
+    void patch_jump(uint32_t at) {
+        //points a forward jump at the next instruction
+
+        int32_t offset = chunk().code.size() - (at + 4);
+        memcpy(&chunk().code[at],&offset,4);
+    }
+
+    void emit_loop(uint32_t start, int line_number) {
+
+        int32_t offset = int32_t(start) - int32_t(chunk().code.size() + 5);
+        emit(OP_JUMP,line_number,uint32_t(offset));
+    }
+
+    void discard(expression* exp, int line_number) {
+
+        if(exp->kind == BINARY_NODE && static_cast<binary_expression*>(exp)->optr.type == EQUAL) {
+            //an assignment whose value nobody reads stores and pops in one instruction
+
+            auto assignment = static_cast<binary_expression*>(exp);
+            visit(assignment->right);
+            access(STORE_ACCESS,static_cast<variable_literal_expression*>(assignment->left)->binding,line_number);
+            return;
+        }
+
+        visit(exp);
+        emit(OP_POP,line_number);
+    }
+
+    void open_scope(uint32_t size) {
+
+        layout.open_scope(size);
+        chunk().frame_size = max(chunk().frame_size,layout.next_slot);
+    }
+
+    void close_scope(uint32_t size) {
+
+        layout.close_scope(size);
+    }
+
+    void access(slot_access kind, frame_slot binding, int line_number) {
+
+        slot_address address = layout.locate(binding);
+        if(address.hops == 0) emit(opcode(OP_GET_LOCAL + kind),line_number,address.slot);
+        else if(address.global) emit(opcode(OP_GET_GLOBAL + kind),line_number,address.slot);
+        else emit(opcode(OP_GET_OUTER + kind),line_number,address.hops,address.slot);
+    }
+
+    void store_declared(uint32_t slot, int line_number) {
+
+        emit(OP_STORE_LOCAL,line_number,layout.declared(slot));
+    }
+
+    void statements(const pmr::vector<statement*> &statements) {
+
+        for(auto stmt: statements) visit(stmt);
+    }
+
+    public:
+    bytecode_compiler(bytecode_program &program, const source_buffer &source): program(program), source(source), constants(program.constants) {}
+
+    void compile_top_level(const vector<statement*> &top_level) {
+
+        program.functions.emplace_back();
+        function = 0;
+        uint32_t size = top_level_frame_size(top_level);
+        open_scope(size);
+        for(auto stmt: top_level) visit(stmt);
+        emit(OP_NIL,0);
+        emit(OP_RETURN,0);
+        close_scope(size);
+    }
+
+    uint32_t compile_function(function_declaration_statement* stmt) {
+
+        uint32_t outer_function = function, outer_stack_depth = stack_depth;
+        uint32_t outer_next_slot = layout.enter_function();
+        program.functions.emplace_back();
+        function = program.functions.size() - 1;
+        chunk().parameter_count = stmt->parameters.size();
+        stack_depth = 0;
+
+        open_scope(stmt->frame_size);
+        visit(stmt->block);
+        emit(OP_NIL,stmt->line_number); //falling off the end returns nil
+        emit(OP_RETURN,stmt->line_number);
+        close_scope(stmt->frame_size);
+
+        uint32_t index = function;
+        layout.leave_function(outer_next_slot);
+        function = outer_function;
+        stack_depth = outer_stack_depth;
+        return index;
+    }
+
+    void visit_conditional_statement(conditional_statement* stmt) {
+
+        visit(stmt->expr);
+        uint32_t to_else = emit_jump(OP_JUMP_IF_FALSE,stmt->line_number);
+        visit(stmt->if_statements);
+        if(stmt->else_statements == NULL) {
+
+            patch_jump(to_else);
+            return;
+        }
+
+        uint32_t to_end = emit_jump(OP_JUMP,stmt->line_number);
+        patch_jump(to_else);
+        visit(stmt->else_statements);
+        patch_jump(to_end);
+    }
+
+    void visit_block_statement(block_statement* stmt) {
+
+        open_scope(stmt->frame_size);
+        statements(stmt->statements);
+        close_scope(stmt->frame_size);
+    }
+
+    void visit_while_statement(while_statement* stmt) {
+
+        uint32_t start = chunk().code.size();
+        visit(stmt->expr);
+        uint32_t to_end = emit_jump(OP_JUMP_IF_FALSE,stmt->line_number);
+        visit(stmt->statements);
+        emit_loop(start,stmt->line_number);
+        patch_jump(to_end);
+    }
+
+    void visit_for_statement(for_statement* stmt) {
+        //the header and a block body share the loop's scope
+
+        open_scope(stmt->frame_size);
+        if(stmt->part1 != NULL) visit(stmt->part1);
+
+        uint32_t start = chunk().code.size();
+        uint32_t to_end = UINT32_MAX;
+        if(stmt->part2 != NULL) {
+
+            visit(stmt->part2);
+            to_end = emit_jump(OP_JUMP_IF_FALSE,stmt->line_number);
+        }
+
+        if(stmt->statements->kind == BLOCK_NODE) statements(static_cast<block_statement*>(stmt->statements)->statements);
+        else visit(stmt->statements);
+        if(stmt->part3 != NULL) discard(stmt->part3,stmt->line_number);
+        emit_loop(start,stmt->line_number);
+
+        if(to_end != UINT32_MAX) patch_jump(to_end);
+        close_scope(stmt->frame_size);
+    }
+
+    void visit_expression_statement(expression_statement* stmt) {
+
+        discard(stmt->exp,stmt->line_number);
+    }
+
+    void visit_declaration_statement(declaration_statement* stmt) {
+
+        if(stmt->exp != NULL) visit(stmt->exp);
+        else emit(OP_NIL,stmt->line_number);
+        store_declared(stmt->slot,stmt->line_number);
+    }
+
+    void visit_print_statement(print_statement* stmt) {
+
+        visit(stmt->exp);
+        emit(OP_PRINT,stmt->line_number);
+    }
+
+    void visit_input_statement(input_statement* stmt) {
+
+        emit(stmt->input_type == STRING_TYPE ? OP_INPUT_STRING : OP_INPUT_NUMBER,stmt->line_number,constants.string(stmt->input_reciever_variable.lexeme(source)));
+        access(STORE_ACCESS,stmt->binding,stmt->line_number);
+    }
+
+    void visit_return_statement(return_statement* stmt) {
+
+        if(stmt->return_exp != NULL) visit(stmt->return_exp);
+        else emit(OP_NIL,stmt->line_number);
+        emit(OP_RETURN,stmt->line_number);
+    }
+
+    void visit_function_declaration_statement(function_declaration_statement* stmt) {
+
+        emit(OP_CLOSURE,stmt->line_number,compile_function(stmt));
+        store_declared(stmt->slot,stmt->line_number);
+    }
+
+    void visit_class_declaration_statement(class_declaration_statement* stmt) {}
+
+    void visit_binary_expression(binary_expression* exp) {
+
+        token_type optr = exp->optr.type;
+        if(optr == EQUAL) {
+
+            visit(exp->right);
+            access(SET_ACCESS,static_cast<variable_literal_expression*>(exp->left)->binding,exp->line_number);
+            return;
+        }
+
+        visit(exp->left);
+        visit(exp->right);
+        switch(optr) {
+
+            case PLUS: emit(OP_ADD,exp->line_number); break;
+            case MINUS: emit(OP_SUBTRACT,exp->line_number); break;
+            case STAR: emit(OP_MULTIPLY,exp->line_number); break;
+            case SLASH: emit(OP_DIVIDE,exp->line_number); break;
+            case LESS: emit(OP_LESS,exp->line_number); break;
+            case LESS_EQUAL: emit(OP_LESS_EQUAL,exp->line_number); break;
+            case GREATER: emit(OP_GREATER,exp->line_number); break;
+            case GREATER_EQUAL: emit(OP_GREATER_EQUAL,exp->line_number); break;
+            case EQUAL_EQUAL: emit(OP_EQUAL,exp->line_number); break;
+            default: emit(OP_NOT_EQUAL,exp->line_number); break;
+        }
+    }
+
+    void visit_logical_expression(logical_expression* exp) {
+
+        visit(exp->left);
+        uint32_t to_end = emit_jump(exp->optr.type == OR ? OP_JUMP_IF_TRUE_OR_POP : OP_JUMP_IF_FALSE_OR_POP,exp->line_number);
+        visit(exp->right);
+        patch_jump(to_end);
+    }
+
+    void visit_unary_expression(unary_expression* exp) {
+
+        visit(exp->right);
+        emit(exp->optr.type == BANG ? OP_NOT : OP_NEGATE,exp->line_number);
+    }
+
+    void visit_literal_expression(literal_expression* exp) {
+
+        switch(exp->literal.type) {
+
+            case NUMBER_TYPE: emit(OP_CONSTANT,exp->line_number,constants.number(exp->literal.number_literal_value(source))); break;
+            case STRING_TYPE: emit(OP_CONSTANT,exp->line_number,constants.string(exp->literal.string_literal_value(source))); break;
+            case TRUE: emit(OP_TRUE,exp->line_number); break;
+            case FALSE: emit(OP_FALSE,exp->line_number); break;
+            default: emit(OP_NIL,exp->line_number); break;
+        }
+    }
+
+    void visit_variable_literal_expression(variable_literal_expression* exp) {
+
+        access(GET_ACCESS,exp->binding,exp->line_number);
+    }
+
+    void visit_function_call_expression(function_call_expression* exp) {
+
+        access(GET_ACCESS,exp->binding,exp->line_number);
+        for(auto argument: exp->arguments) visit(argument);
+        emit(OP_CALL,exp->line_number,exp->arguments.size());
+    }
+
+};
+
+bytecode_program compile_program(const vector<statement*> &program, const source_buffer &source) {
+
+    bytecode_program compiled;
+    bytecode_compiler compiler(compiled,source);
+    compiler.compile_top_level(program);
+    return compiled;
+}
@@ -0,0 +1,145 @@
+//bytecode.h
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ast.h"
+#include "value.h"
+
+typedef enum : uint8_t {
+    /* one byte per opcode, followed by its operands as unaligned 32 bit words. Jump offsets are signed and count
+     * from the end of the jump instruction. The stack effect of every opcode is in stack_effect */
+
+    OP_CONSTANT, //index into the constant pool
+    OP_NIL,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+    OP_GET_LOCAL, //slot in the frame of the running function
+    OP_SET_LOCAL, //slot, the value stays on the stack as the result of the assignment
+    OP_STORE_LOCAL, //slot, pops the value
+    OP_GET_GLOBAL, //slot in the frame of the top level statements
+    OP_SET_GLOBAL,
+    OP_STORE_GLOBAL,
+    OP_GET_OUTER, //hops out along the declaring frames, slot
+    OP_SET_OUTER,
+    OP_STORE_OUTER,
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_NEGATE,
+    OP_NOT,
+    OP_JUMP, //offset
+    OP_JUMP_IF_FALSE, //offset, pops the condition
+    OP_JUMP_IF_FALSE_OR_POP, //offset. and: keeps a false left operand as the result and jumps, or pops it
+    OP_JUMP_IF_TRUE_OR_POP, //offset. or
+    OP_CLOSURE, //function index, pushes the function with the running frame as the one it was declared in
+    OP_CALL, //argument count, the callee sits below the arguments
+    OP_RETURN,
+    OP_PRINT,
+    OP_INPUT_NUMBER, //constant holding the name of the receiving variable, for the error when input runs out
+    OP_INPUT_STRING,
+    OP_COUNT
+
+} opcode;
+
+class line_table {
+
+    public:
+    std::vector<std::pair<uint32_t,int>> lines; //(code offset, line) wherever the line changes
+    void mark(uint32_t offset, int line_number);
+    int line_of(uint32_t offset) const;
+
+};
+
+class compiled_function: public line_table {
+
+    public:
+    std::vector<uint8_t> code;
+    uint32_t parameter_count = 0;
+    uint32_t frame_size = 0; //the parameters, then every block of the body laid out in disjoint ranges
+    uint32_t max_stack = 0; //deepest the operand stack above the frame gets
+
+};
+
+class bytecode_program {
+
+    public:
+    std::vector<compiled_function> functions; //functions[0] runs the top level statements
+    std::vector<value> constants; //number and string literals, each stored once
+
+};
+
+class scope_record {
+
+    public:
+    uint32_t level; //functions open around the scope, 0 for the scopes of the top level statements
+    uint32_t base; //where the slots of the scope start in the frame of its function
+
+};
+
+class slot_address {
+
+    public:
+    uint32_t hops; //functions out from the one being compiled, 0 for its own frame
+    uint32_t slot;
+    bool global; //in the frame of the top level statements, which is never more than a slot index away
+
+};
+
+class frame_layout {
+
+    /* where the slots semantic_analyser resolved end up once the blocks of a function are folded into its frame. The
+     * layout mirrors the scopes the analyser opened, so a frame_slot picks its scope depth entries from the end. Every
+     * scope takes the next free range of its function's frame and gives it back when it closes, so sibling blocks
+     * share slots */
+
+    std::vector<scope_record> scopes;
+
+    public:
+    uint32_t level = 0; //functions open around the code being compiled
+    uint32_t next_slot = 0; //first slot of the function's frame not taken by an open scope
+
+    void open_scope(uint32_t size);
+    void close_scope(uint32_t size);
+    uint32_t enter_function(); //returns what leave_function needs back
+    void leave_function(uint32_t outer_next_slot);
+    slot_address locate(ast::frame_slot binding) const;
+    uint32_t declared(uint32_t slot) const; //a declaration always goes into the innermost scope
+
+};
+
+class constant_pool {
+
+    //adds literals to a program's constants, each number once and each string as its interned object
+
+    std::vector<value> &constants;
+    std::unordered_map<double,uint32_t> numbers;
+    std::unordered_map<std::string_view,uint32_t> strings;
+
+    public:
+    constant_pool(std::vector<value> &constants);
+    uint32_t number(double literal);
+    uint32_t string(std::string_view literal);
+
+};
+
+/* compiles an analysed program. Names are turned into the slots semantic_analyser resolved them to, with the blocks
+ * of a function folded into its frame, so the VM only walks frames to reach the locals of enclosing functions */
+bytecode_program compile_program(const std::vector<ast::statement*> &program, const tok::source_buffer &source);
+
+int stack_effect(opcode op, uint32_t operand);
+uint32_t operand_count(opcode op);
+
+#endif
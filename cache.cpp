@@ -0,0 +1,337 @@
+#include "cache.h"
+#include "string_pool.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ast;
+using namespace std;
+using namespace tok;
+
+
+const char cache_magic[8] = {'A','L','O','X','A','S','T','\0'};
+
+class cache_header {
+
+    public:
+    char magic[8];
+    uint32_t version;
+    uint32_t error_status;
+    uint64_t source_size;
+    uint64_t source_hash;
+
+};
+
+//which nodes use a column. Only their entries are written, the others hold what flat_tree::add_node puts there
+static bool has_token(node_kind kind) {
+
+    return kind != EXPRESSION_STATEMENT_NODE && kind != PRINT_NODE && kind != RETURN_NODE && kind != CONDITIONAL_NODE
+        && kind != WHILE_NODE && kind != FOR_NODE;
+}
+static bool has_first(node_kind kind) { return kind != LITERAL_NODE && kind != VARIABLE_NODE && kind != INPUT_NODE; }
+static bool has_second(node_kind kind) {
+
+    return kind == BINARY_NODE || kind == LOGICAL_NODE || kind == CALL_NODE || kind == DECLARATION_NODE || kind == INPUT_NODE
+        || kind == BLOCK_NODE || kind == CONDITIONAL_NODE || kind == WHILE_NODE || kind == CLASS_NODE;
+}
+static bool has_type(node_kind kind) { return kind <= CALL_NODE; }
+static bool has_depth(node_kind kind) { return kind == VARIABLE_NODE || kind == CALL_NODE || kind == INPUT_NODE; }
+static bool has_slot(node_kind kind) { return has_depth(kind) || kind == DECLARATION_NODE || kind == FUNCTION_NODE || kind == BLOCK_NODE || kind == FOR_NODE; }
+
+class cache_writer {
+
+    public:
+    string bytes;
+
+    void raw(const void* data, size_t size) {
+
+        bytes.append(static_cast<const char*>(data),size);
+        bytes.resize((bytes.size() + 7) & ~size_t(7),'\0');
+    }
+
+    template<class element_type>
+    void column(const vector<element_type> &elements) {
+
+        uint64_t count = elements.size();
+        raw(&count,sizeof(count));
+        raw(elements.data(),count * sizeof(element_type));
+    }
+
+    template<class element_type>
+    void sparse_column(const vector<element_type> &elements, const vector<node_kind> &kinds, bool (*used)(node_kind)) {
+
+        vector<element_type> kept;
+        for(size_t id = 0; id<elements.size(); id++) if(used(kinds[id])) kept.push_back(elements[id]);
+        column(kept);
+    }
+
+    void strings(const vector<string_view> &texts) {
+        //the lengths, then all characters in one column
+
+        vector<uint32_t> lengths;
+        string characters;
+        for(auto text: texts) {
+
+            lengths.push_back(text.size());
+            characters += text;
+        }
+
+        column(lengths);
+        column(vector<char>(characters.begin(),characters.end()));
+    }
+
+};
+
+class cache_reader {
+
+    //reads what cache_writer wrote out of a mapped file, every read is checked against the end of the file
+
+    const char* cursor;
+    const char* end;
+
+    public:
+    cache_reader(const char* begin, const char* end): cursor(begin), end(end) {}
+
+    bool raw(void* data, size_t size) {
+
+        size_t padded = (size + 7) & ~size_t(7);
+        if(size_t(end - cursor) < padded) return false;
+        if(size > 0) memcpy(data,cursor,size);
+        cursor += padded;
+        return true;
+    }
+
+    template<class element_type>
+    bool column(vector<element_type> &elements) {
+
+        uint64_t count;
+        if(!raw(&count,sizeof(count)) || count > size_t(end - cursor) / sizeof(element_type)) return false;
+        elements.resize(count);
+        return raw(elements.data(),count * sizeof(element_type));
+    }
+
+    template<class element_type>
+    bool sparse_column(vector<element_type> &elements, const vector<node_kind> &kinds, bool (*used)(node_kind), element_type absent) {
+        //spreads the entries back out over the nodes that use the column, there has to be exactly one for each
+
+        vector<element_type> kept;
+        if(!column(kept)) return false;
+
+        elements.assign(kinds.size(),absent);
+        size_t next = 0;
+        for(size_t id = 0; id<kinds.size(); id++) {
+
+            if(!used(kinds[id])) continue;
+            if(next == kept.size()) return false;
+            elements[id] = kept[next++];
+        }
+        return next == kept.size();
+    }
+
+    bool strings(vector<string> &texts) {
+
+        vector<uint32_t> lengths;
+        vector<char> characters;
+        if(!column(lengths) || !column(characters)) return false;
+
+        size_t offset = 0;
+        for(auto length: lengths) {
+
+            if(length > characters.size() - offset) return false;
+            texts.emplace_back(characters.data() + offset,length);
+            offset += length;
+        }
+        return true;
+    }
+
+    bool finished() const { return cursor == end; }
+
+};
+
+
+uint64_t ast:: content_hash(const char* data, size_t size) {
+    /* a word at a time multiply and rotate hash with the murmur3 finaliser. Not cryptographic, the header also
+     * records the source size and a hit is only as good as a 64 bit hash */
+
+    const uint64_t k1 = 0x87c37b91114253d5, k2 = 0x4cf5ad432745937f;
+    uint64_t hash = 0x9e3779b97f4a7c15 ^ size;
+
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+
+        uint64_t word;
+        memcpy(&word,data + i,8);
+        word *= k1;
+        word = (word << 31) | (word >> 33);
+        hash ^= word * k2;
+        hash = ((hash << 27) | (hash >> 37)) * 5 + 0x52dce729;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail,data + i,size - i);
+    hash ^= tail * k1;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+
+program_cache:: program_cache(string directory): directory(directory) {}
+
+string program_cache:: default_directory() {
+
+    const char* configured = getenv("ALOX_CACHE_DIR");
+    if(configured != NULL) return configured;
+
+    const char* home = getenv("HOME");
+    return home == NULL ? "" : string(home) + "/.cache/alox";
+}
+
+string program_cache:: path_of(uint64_t hash) const {
+
+    char name[32];
+    snprintf(name,sizeof(name),"/%016llx.ast",(unsigned long long)hash);
+    return directory + name;
+}
+
+bool program_cache:: load(source_buffer &source, cached_program &program) {
+
+    if(directory.empty()) return false;
+
+    uint64_t hash = content_hash(source.data(),source.size());
+    int file = open(path_of(hash).c_str(),O_RDONLY);
+    if(file < 0) return false;
+
+    struct stat file_status;
+    void* mapping = MAP_FAILED;
+    if(fstat(file,&file_status) == 0 && size_t(file_status.st_size) >= sizeof(cache_header)) {
+
+        mapping = mmap(NULL,file_status.st_size,PROT_READ,MAP_PRIVATE,file,0);
+    }
+    close(file);
+    if(mapping == MAP_FAILED) return false;
+
+    const char* begin = static_cast<const char*>(mapping);
+    cache_reader reader(begin,begin + file_status.st_size);
+    cache_header header;
+    reader.raw(&header,sizeof(header));
+
+    flat_tree &tree = program.tree;
+    vector<double> number_literals;
+    vector<string> identifiers;
+
+    bool valid = memcmp(header.magic,cache_magic,sizeof(cache_magic)) == 0 && header.version == cache_format_version
+        && header.source_size == source.size() && header.source_hash == hash
+        && reader.column(tree.kinds) && reader.column(tree.line_numbers) && reader.sparse_column(tree.tokens,tree.kinds,has_token,token())
+        && reader.sparse_column(tree.first,tree.kinds,has_first,no_node) && reader.sparse_column(tree.second,tree.kinds,has_second,no_node)
+        && reader.column(tree.extra)
+        && reader.sparse_column(tree.expression_types,tree.kinds,has_type,token_type(tok::ERROR))
+        && reader.sparse_column(tree.depths,tree.kinds,has_depth,uint32_t(0)) && reader.sparse_column(tree.slots,tree.kinds,has_slot,uint32_t(0))
+        && reader.column(tree.parameter_names) && reader.column(tree.parameter_types) && reader.column(tree.roots)
+        && reader.column(number_literals) && reader.strings(identifiers) && reader.strings(program.diagnostics) && reader.finished();
+
+    //a file that is whole but not what store wrote, a corrupted one, must not reach unflatten
+    valid = valid && tree.well_formed(source.size());
+    for(size_t id = 0; valid && id<tree.tokens.size(); id++) {
+
+        valid = tree.tokens[id].type != NUMBER_TYPE || tree.tokens[id].literal_index < number_literals.size();
+    }
+    munmap(mapping,file_status.st_size);
+
+    if(!valid) {
+
+        program = cached_program();
+        return false;
+    }
+
+    //symbol ids are only meaningful within the pool they were interned into, so they are re-interned here
+    vector<uint32_t> symbol_ids(identifiers.size());
+    string_pool &pool = global_string_pool();
+    for(size_t id = 0; id<identifiers.size(); id++) symbol_ids[id] = pool.intern(identifiers[id]);
+
+    auto rebase = [&](token &t) { if(t.type == IDENTIFIER && t.symbol_id < symbol_ids.size()) t.symbol_id = symbol_ids[t.symbol_id]; };
+    for(auto &t: tree.tokens) rebase(t);
+    for(auto &t: tree.parameter_names) rebase(t);
+
+    source.number_literals = std::move(number_literals);
+    program.error_status = header.error_status != 0;
+    return true;
+}
+
+static bool make_directories(const string &path) {
+
+    for(size_t slash = path.find('/',1); ; slash = path.find('/',slash + 1)) {
+
+        string prefix = path.substr(0,slash);
+        if(mkdir(prefix.c_str(),0755) != 0 && errno != EEXIST) return false;
+        if(slash == string::npos) return true;
+    }
+}
+
+bool program_cache:: store(const source_buffer &source, const cached_program &program) {
+
+    if(directory.empty() || !make_directories(directory)) return false;
+
+    uint64_t hash = content_hash(source.data(),source.size());
+    cache_header header;
+    memcpy(header.magic,cache_magic,sizeof(cache_magic));
+    header.version = cache_format_version;
+    header.error_status = program.error_status;
+    header.source_size = source.size();
+    header.source_hash = hash;
+
+    const flat_tree &tree = program.tree;
+    string_pool &pool = global_string_pool();
+    vector<string_view> identifiers(pool.size());
+    for(uint32_t id = 0; id<identifiers.size(); id++) identifiers[id] = pool.lookup(id);
+
+    cache_writer writer;
+    writer.bytes.reserve(sizeof(header) + tree.bytes() + source.number_literals.size() * sizeof(double) + (1 << 16));
+    writer.raw(&header,sizeof(header));
+    writer.column(tree.kinds);
+    writer.column(tree.line_numbers);
+    writer.sparse_column(tree.tokens,tree.kinds,has_token);
+    writer.sparse_column(tree.first,tree.kinds,has_first);
+    writer.sparse_column(tree.second,tree.kinds,has_second);
+    writer.column(tree.extra);
+    writer.sparse_column(tree.expression_types,tree.kinds,has_type);
+    writer.sparse_column(tree.depths,tree.kinds,has_depth);
+    writer.sparse_column(tree.slots,tree.kinds,has_slot);
+    writer.column(tree.parameter_names);
+    writer.column(tree.parameter_types);
+    writer.column(tree.roots);
+    writer.column(source.number_literals);
+    writer.strings(identifiers);
+    writer.strings(vector<string_view>(program.diagnostics.begin(),program.diagnostics.end()));
+
+    string path = path_of(hash);
+    string temporary = path + ".tmp" + to_string(getpid());
+    int file = open(temporary.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if(file < 0) return false;
+
+    size_t written = 0;
+    while(written < writer.bytes.size()) {
+
+        ssize_t count = write(file,writer.bytes.data() + written,writer.bytes.size() - written);
+        if(count < 0 && errno == EINTR) continue;
+        if(count <= 0) break;
+        written += count;
+    }
+
+    bool complete = close(file) == 0 && written == writer.bytes.size();
+    if(!complete || rename(temporary.c_str(),path.c_str()) != 0) {
+
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+//cache.h
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "flat_ast.h"
+#include "source.h"
+
+namespace ast {
+
+const uint32_t cache_format_version = 5; //bump whenever the file layout, the token layout, the node kinds or the diagnostics change
+
+class cached_program {
+
+    /* what a run of the front end leaves behind: the analysed tree with its expression types and every diagnostic
+     * the parser and semantic_analyser printed, in order */
+
+    public:
+    flat_tree tree;
+    std::vector<std::string> diagnostics;
+    bool error_status = false; //the parser failed, so the program was not analysed
+
+};
+
+class program_cache {
+
+    /* binary cache of analysed programs, one file per source text in a directory, named by a hash of the text.
+     * A file holds a header and the columns of the flat tree followed by the literal table, the identifiers
+     * the tokens refer to and the diagnostics, each as a count and raw little endian data padded to 8 bytes. A column
+     * only some kinds of node use holds just their entries. Even so a file is about five times the size of its source
+     * Files are written to a temporary name and renamed, so a reader never sees half a file */
+
+    std::string directory;
+
+    std::string path_of(uint64_t hash) const;
+
+    public:
+    program_cache(std::string directory);
+    static std::string default_directory(); //$ALOX_CACHE_DIR, else ~/.cache/alox
+
+    //true on a hit. Also fills the literal table of the source and interns the identifiers into the global string pool
+    bool load(tok::source_buffer &source, cached_program &program);
+    bool store(const tok::source_buffer &source, const cached_program &program);
+
+};
+
+uint64_t content_hash(const char* data, size_t size);
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "deep_stack.h"
+#include <algorithm>
+#include <exception>
+#include <new>
+#include <vector>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+size_t stack_segment_size = 1 << 23;
+
+class stack_segment_call {
+
+    public:
+    const function<void()>* task;
+    exception_ptr failure;
+    ucontext_t caller;
+    ucontext_t callee;
+
+};
+
+class segment_cache {
+
+    public:
+    vector<void*> segments; //each mapping starts with its guard page
+    size_t size = 0; //stack_segment_size when the segments were mapped
+
+    ~segment_cache() { for(auto segment: segments) munmap(segment,size + guard_size()); }
+
+    static size_t guard_size() {
+
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        return page;
+    }
+
+};
+
+const size_t assumed_stack_left = 1 << 18; //below the first deep_call, on a thread whose stack bounds cannot be looked up
+
+static thread_local stack_segment_call* current_call = NULL;
+static thread_local segment_cache free_segments;
+
+void set_stack_segment_size(size_t bytes) {
+
+    stack_segment_size = max(bytes,4 * stack_reserve);
+}
+
+bool stack_exhausted() {
+
+    if(stack_floor == UINTPTR_MAX) {
+        //first deep_call of this thread, look up where its stack ends
+
+        pthread_attr_t attributes;
+        void* lowest = NULL;
+        size_t size = 0;
+        if(pthread_getattr_np(pthread_self(),&attributes) == 0) {
+
+            if(pthread_attr_getstack(&attributes,&lowest,&size) != 0) lowest = NULL;
+            pthread_attr_destroy(&attributes);
+        }
+
+        uintptr_t here = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        if(lowest != NULL) stack_floor = reinterpret_cast<uintptr_t>(lowest) + stack_reserve;
+        else stack_floor = here - min<uintptr_t>(here,assumed_stack_left); //unknown end, so assume little is left and move to segments early
+    }
+
+    return reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) <= stack_floor;
+}
+
+static void segment_entry() {
+    //exceptions cannot unwind past the start of a segment, so they are caught here and rethrown on the caller's stack
+
+    stack_segment_call* call = current_call;
+    try {
+
+        (*call->task)();
+    }
+    catch(...) {
+
+        call->failure = current_exception();
+    }
+}
+
+void run_on_stack_segment(const function<void()> &task) {
+
+    if(free_segments.size != stack_segment_size) {
+
+        for(auto segment: free_segments.segments) munmap(segment,free_segments.size + segment_cache::guard_size());
+        free_segments.segments.clear();
+        free_segments.size = stack_segment_size;
+    }
+
+    size_t size = free_segments.size, guard = segment_cache::guard_size();
+    char* segment;
+    if(!free_segments.segments.empty()) {
+
+        segment = static_cast<char*>(free_segments.segments.back());
+        free_segments.segments.pop_back();
+    }
+    else {
+        //a rule which recurses past stack_reserve between two deep_calls faults on the guard page instead of writing below the segment
+
+        void* mapping = mmap(NULL,guard + size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+        if(mapping == MAP_FAILED) throw bad_alloc();
+        segment = static_cast<char*>(mapping);
+        if(mprotect(segment,guard,PROT_NONE) != 0) {
+
+            munmap(segment,guard + size);
+            throw bad_alloc();
+        }
+    }
+
+    stack_segment_call call;
+    call.task = &task;
+    getcontext(&call.callee);
+    call.callee.uc_stack.ss_sp = segment + guard;
+    call.callee.uc_stack.ss_size = size;
+    call.callee.uc_link = &call.caller; //resume here once segment_entry returns
+    makecontext(&call.callee,segment_entry,0);
+
+    stack_segment_call* outer_call = current_call;
+    uintptr_t outer_floor = stack_floor;
+    current_call = &call;
+    stack_floor = reinterpret_cast<uintptr_t>(segment + guard) + stack_reserve;
+    swapcontext(&call.caller,&call.callee);
+    current_call = outer_call;
+    stack_floor = outer_floor;
+
+    /* kept for the rest of the outermost deep pass, which keeps moving on and off segments as it walks up and down the
+     * tree and finds them already faulted in. Once that pass returns they are all unmapped, so one pathological input
+     * does not pin memory on a thread which lives as long as the process, like a pool worker */
+    if(outer_call != NULL && free_segments.size == size) free_segments.segments.push_back(segment);
+    else munmap(segment,guard + size);
+    if(outer_call == NULL) {
+
+        for(auto cached: free_segments.segments) munmap(cached,free_segments.size + guard);
+        free_segments.segments.clear();
+    }
+
+    if(call.failure) rethrow_exception(call.failure);
+}
@@ -0,0 +1,53 @@
+//deep_stack.h
+#ifndef DEEP_STACK_H
+#define DEEP_STACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/* recursion without a depth limit for the parser and the tree passes. Every recursive rule goes through deep_call,
+ * which compares the stack pointer with a per thread floor. Once a rule gets within stack_reserve bytes of the end of
+ * its stack, the call continues on a fresh segment of stack_segment_size bytes taken from the heap, above a guard page
+ * which turns an overrun into a fault. Machine generated programs with a million nested parentheses or a million
+ * operand + chain therefore cost memory, not a crash */
+
+extern size_t stack_segment_size;
+const size_t stack_reserve = 1 << 16; //room left for the frames between two deep_calls
+
+//deep_call moves to a new segment below this address. It starts out high, so the first call measures the thread's own stack
+inline thread_local uintptr_t stack_floor = UINTPTR_MAX;
+
+void set_stack_segment_size(size_t bytes);
+bool stack_exhausted();
+void run_on_stack_segment(const std::function<void()> &task); //runs task on a new segment, exceptions are passed on
+
+template<class function_type>
+__attribute__((noinline)) auto call_on_stack_segment(function_type &function) -> decltype(function()) {
+    //the slow path of deep_call, kept out of line so that the check itself inlines into every recursive rule
+
+    if(!stack_exhausted()) return function();
+
+    if constexpr (std::is_void_v<decltype(function())>) {
+
+        run_on_stack_segment(function);
+    }
+    else {
+
+        std::optional<decltype(function())> result;
+        run_on_stack_segment([&]() { result.emplace(function()); });
+        return std::move(*result);
+    }
+}
+
+template<class function_type>
+inline auto deep_call(function_type &&function) -> decltype(function()) {
+
+    if(reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) > stack_floor) [[likely]] return function();
+    return call_on_stack_segment(function);
+}
+
+#endif
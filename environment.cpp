@@ -9,43 +9,75 @@ using namespace tok;
 //SYMBOL TABLE IMPLEMENTATIONS
 
 
-symbol_table_entry symbol_table:: get_entry(tok:: token symbol) {
+uint32_t symbol_table:: lookup(uint32_t symbol_id) const {
 
+    return symbol_id < innermost.size() ? innermost[symbol_id] : no_binding;
+}
 
-    int stack_top = this->scopes.size()-1;
+const symbol_binding* symbol_table:: find_binding(uint32_t symbol_id) const {
 
-    while(stack_top>=0) {
+    uint32_t binding = lookup(symbol_id);
+    if(binding != no_binding) return &bindings[binding];
+    if(globals == NULL) return NULL;
 
+    binding = globals->lookup(symbol_id);
+    return binding < visible_globals ? &globals->bindings[binding] : NULL;
+}
 
-        if(this->scopes[stack_top].count(symbol.lexeme)) return this->scopes[stack_top][symbol.lexeme];
-        else stack_top--;
+uint32_t symbol_table:: outer_scopes() const {
 
-    }
+    return globals == NULL ? 0 : 1;
+}
+
+const symbol_table_entry* symbol_table:: find_entry(tok:: token symbol) const {
 
+    const symbol_binding* binding = find_binding(symbol.symbol_id);
+    return binding == NULL ? NULL : &binding->entry;
+}
+
+const symbol_table_entry& symbol_table:: get_entry(tok:: token symbol) const {
 
-    throw "Entry not found";
+    const symbol_table_entry* entry = find_entry(symbol);
+    if(entry == NULL) throw "Entry not found";
+    return *entry;
 
 }
-bool symbol_table:: resolve_identifier(tok:: token identifier) {
+bool symbol_table:: resolve_identifier(tok:: token identifier) const {
 
+    return find_binding(identifier.symbol_id) != NULL;
+}
 
-    int stack_top = this->scopes.size()-1;
+bool symbol_table:: is_redeclaration(tok:: token identifier) const {
 
-    while(stack_top>=0) {
+    uint32_t binding = lookup(identifier.symbol_id);
+    return binding != no_binding && binding >= scope_starts.back();
 
+}
 
-        if(this->scopes[stack_top].count(identifier.lexeme)) return true;
-        else stack_top--;
+uint32_t symbol_table:: depth_of(tok::token symbol) const {
 
-    }
+    return outer_scopes() + scope_starts.size() - 1 - find_binding(symbol.symbol_id)->scope;
+}
+
+uint32_t symbol_table:: slot_of(tok::token symbol) const {
+
+    return find_binding(symbol.symbol_id)->slot;
+}
+
+uint32_t symbol_table:: scope_size() const {
 
-    return false;
+    return bindings.size() - scope_starts.back();
 }
 
-bool symbol_table:: is_redeclaration(tok:: token identifier) {
+size_t symbol_table:: binding_count() const {
 
-    return this->scopes[scopes.size()-1].count(identifier.lexeme);
+    return bindings.size();
+}
+
+void symbol_table:: share_globals(const symbol_table &global_table, size_t visible) {
 
+    globals = &global_table;
+    visible_globals = visible;
 }
 
 void symbol_table:: start_scope(token name) {
@@ -58,14 +90,20 @@ void symbol_table:: start_scope(token name) {
 
 void symbol_table:: start_scope() {
 
-    map<string,symbol_table_entry> new_scope;
-    this->scopes.push_back(new_scope);
+    this->scope_starts.push_back(bindings.size());
 
 }
 
 void symbol_table:: end_scope(bool is_function_scope) {
 
-    this->scopes.pop_back();
+    size_t start = scope_starts.back();
+    scope_starts.pop_back();
+
+    while(bindings.size() > start) { //undo the scope's declarations, newest first
+
+        innermost[bindings.back().symbol_id] = bindings.back().shadowed;
+        bindings.pop_back();
+    }
 
     if(is_function_scope) {
 
@@ -76,7 +114,8 @@ void symbol_table:: end_scope(bool is_function_scope) {
 }
 void symbol_table:: modify_entry(token symbol, symbol_table_entry symbol_information) {
     //API specifically designed for declaration statements
-    scopes[scopes.size()-1][symbol.lexeme] = symbol_information;
+    if(is_redeclaration(symbol)) bindings[innermost[symbol.symbol_id]].entry = symbol_information;
+    else add_entry(symbol,symbol_information);
 
 }
 
@@ -85,15 +124,19 @@ void symbol_table:: modify_entry(token symbol, symbol_table_entry symbol_informa
 void symbol_table:: add_entry(token symbol, symbol_table_entry symbol_information) {
     //API specifically designed for declaration statements
 
-    int top_index = scopes.size()-1;
-    if(scopes[top_index].count(symbol.lexeme)) {
+    if(is_redeclaration(symbol)) {
         //implies identifier declared before
 
         throw "redeclaration error";
     }
     else
     {
-        scopes[top_index][symbol.lexeme] = symbol_information;
+        if(symbol.symbol_id >= innermost.size()) innermost.resize(symbol.symbol_id + 1,no_binding);
+        //the bindings of the innermost scope are the last ones, so the next slot is their count
+        uint32_t scope = outer_scopes() + scope_starts.size() - 1;
+        uint32_t slot = scope_size();
+        bindings.push_back(symbol_binding{symbol.symbol_id,innermost[symbol.symbol_id],scope,slot,std::move(symbol_information)});
+        innermost[symbol.symbol_id] = bindings.size() - 1;
     }
 }
 
@@ -121,9 +164,9 @@ token symbol_table:: get_current_function() {
 //SYMBOL TABLE ENTRIES
 
 
-symbol_table_entry:: symbol_table_entry(tok::token_type symbol_type): symbol_type(symbol_type) {};
-symbol_table_entry:: symbol_table_entry(tok::token_type symbol_type,std::vector<std::pair<tok::token,tok::token_type>> parameters, token_type return_type):  symbol_type(symbol_type), parameters(parameters), return_type(return_type) {}
-symbol_table_entry:: symbol_table_entry() {}
+symbol_table_entry:: symbol_table_entry(tok::token_type symbol_type): symbol_type(symbol_type), return_type(tok::ERROR) {};
+symbol_table_entry:: symbol_table_entry(tok::token_type symbol_type,std::vector<std::pair<tok::token,tok::token_type>> parameters, token_type return_type):  symbol_type(symbol_type), return_type(return_type), parameters(parameters) {}
+symbol_table_entry:: symbol_table_entry(): symbol_type(tok::ERROR), return_type(tok::ERROR) {}
 
 
 
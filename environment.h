@@ -1,9 +1,8 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
-#include<map>
-#include<any>
 #include<string>
+#include<cstdint>
 #include<vector>
 #include<utility>
 #include "token.h"
@@ -24,17 +23,44 @@ class  symbol_table_entry {
 
 };
 
+class symbol_binding {
+
+    /* one declaration of an open scope */
+
+    public:
+    uint32_t symbol_id;
+    uint32_t shadowed; //the binding of the same name this one hides, or no_binding
+    uint32_t scope; //how many scopes were open around the declaring one
+    uint32_t slot; //position among the declarations of its scope
+    symbol_table_entry entry;
+
+};
+
 class symbol_table {
 
+    /* maps every name straight to its innermost binding, so a lookup costs the same however deeply the scopes are
+     * nested. Names are interned symbol ids, which are dense, so the map is a plain array indexed by id rather than a
+     * hash table. bindings doubles as the undo log of the scopes: end_scope pops the bindings the closing scope made
+     * and points their names back at the bindings they had shadowed. Every scope is a frame for the evaluator: a binding
+     * gets the next slot of its scope, and a name is found depth_of() scopes out from the innermost one at slot_of() */
 
-    std:: vector<std::map<std::string,symbol_table_entry>> scopes;
+    static constexpr uint32_t no_binding = UINT32_MAX;
 
-    /* Above data structure is a stack of pairs. Each pair represents a scope .
-    First element of the pair is the name of the scope, 2nd element is a hash table with entries of that scope */
+    std::vector<uint32_t> innermost; //symbol id -> index in bindings, or no_binding
+    std::vector<symbol_binding> bindings;
+    std::vector<size_t> scope_starts; //size of bindings when each open scope started
+
+    //a worker of the parallel analysis sees the global scope of the main table without copying it, see share_globals
+    const symbol_table* globals = NULL;
+    size_t visible_globals = 0;
 
     std:: vector<tok::token> function_tracker;
     
     /*Above data structure is a stack of function names. It is used to track which function we are in currently during the semantic analysis phase. */
+
+    uint32_t lookup(uint32_t symbol_id) const;
+    const symbol_binding* find_binding(uint32_t symbol_id) const; //in this table or else among the shared globals
+    uint32_t outer_scopes() const; //scopes open around the first one of this table
     
     public:
     void start_scope(tok::token function_name);
@@ -44,9 +70,19 @@ class symbol_table {
     void add_entry(tok::token symbol, symbol_table_entry symbol_information);
     void modify_entry(tok::token symbol, symbol_table_entry symbol_information);
     tok::token get_current_function();
-    symbol_table_entry get_entry(tok:: token symbol);
-    bool resolve_identifier(tok:: token identifier);
-    bool is_redeclaration(tok:: token identifier);
+    //entries stay where they are until the next add_entry or end_scope
+    const symbol_table_entry& get_entry(tok:: token symbol) const;
+    const symbol_table_entry* find_entry(tok:: token symbol) const; //NULL for an unknown name
+    bool resolve_identifier(tok:: token identifier) const;
+    bool is_redeclaration(tok:: token identifier) const;
+    uint32_t depth_of(tok::token symbol) const;
+    uint32_t slot_of(tok::token symbol) const;
+    uint32_t scope_size() const; //declarations of the innermost scope so far, its frame size once it ends
+    size_t binding_count() const;
+    /* names not bound in this table are then looked up among the first visible bindings of the outermost scope of
+     * global_table, which is read but never written. The global scope never shadows one of its own names, so those
+     * are exactly the globals declared before a given point. Only while this table has no scope open */
+    void share_globals(const symbol_table &global_table, size_t visible);
 
 };
 
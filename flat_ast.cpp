@@ -0,0 +1,357 @@
+#include "flat_ast.h"
+
+using namespace ast;
+using namespace std;
+using namespace tok;
+
+
+uint32_t flat_tree:: add_node(node_kind kind, int line_number, token main_token, uint32_t first, uint32_t second) {
+
+    kinds.push_back(kind);
+    line_numbers.push_back(line_number);
+    tokens.push_back(main_token);
+    this->first.push_back(first);
+    this->second.push_back(second);
+    expression_types.push_back(tok::ERROR);
+    depths.push_back(0);
+    slots.push_back(0);
+    return kinds.size() - 1;
+}
+
+uint32_t flat_tree:: add_extra(const vector<uint32_t> &values) {
+
+    uint32_t index = extra.size();
+    extra.insert(extra.end(),values.begin(),values.end());
+    return index;
+}
+
+size_t flat_tree:: size() const {
+
+    return kinds.size();
+}
+
+size_t flat_tree:: bytes() const {
+
+    return kinds.size() * (sizeof(node_kind) + sizeof(int) + sizeof(token) + 4 * sizeof(uint32_t) + sizeof(token_type))
+        + extra.size() * sizeof(uint32_t) + parameter_names.size() * (sizeof(token) + sizeof(token_type)) + roots.size() * sizeof(uint32_t);
+}
+
+bool flat_tree:: well_formed(size_t source_size) const {
+
+    size_t nodes = kinds.size();
+    if(line_numbers.size() != nodes || tokens.size() != nodes || first.size() != nodes || second.size() != nodes
+        || expression_types.size() != nodes || depths.size() != nodes || slots.size() != nodes || parameter_types.size() != parameter_names.size()) return false;
+
+    auto is_expression = [&](uint32_t id) { return kinds[id] <= CALL_NODE; };
+    auto within_source = [&](const token &t) { return t.offset <= source_size && t.length <= source_size - t.offset; };
+    auto within = [](uint32_t begin, uint32_t count, size_t size) { return begin <= size && count <= size - begin; };
+
+    for(uint32_t id = 0; id<nodes; id++) {
+
+        //a child is stored before the node that refers to it, absent children are no_node and only allowed where flatten writes them
+        auto expression_child = [&](uint32_t child, bool optional) { return child == no_node ? optional : child < id && is_expression(child); };
+        auto statement_child = [&](uint32_t child) { return child == no_node || (child < id && !is_expression(child)); };
+
+        uint32_t a = first[id], b = second[id];
+        bool children = true;
+        switch(kinds[id]) {
+
+            case BINARY_NODE: case LOGICAL_NODE: children = expression_child(a,false) && expression_child(b,false); break;
+            case UNARY_NODE: case EXPRESSION_STATEMENT_NODE: case PRINT_NODE: children = expression_child(a,false); break;
+            case RETURN_NODE: case DECLARATION_NODE: children = expression_child(a,true); break;
+            case LITERAL_NODE: case VARIABLE_NODE: case INPUT_NODE: break;
+            case CALL_NODE: {
+
+                children = within(a,b,extra.size());
+                for(uint32_t i = 0; children && i<b; i++) children = expression_child(extra[a + i],false);
+                break;
+            }
+            case BLOCK_NODE: case CLASS_NODE: {
+
+                children = within(a,b,extra.size());
+                for(uint32_t i = 0; children && i<b; i++) children = statement_child(extra[a + i]);
+                break;
+            }
+            case CONDITIONAL_NODE: children = expression_child(a,false) && within(b,2,extra.size()) && statement_child(extra[b]) && statement_child(extra[b + 1]); break;
+            case WHILE_NODE: children = expression_child(a,false) && statement_child(b); break;
+            case FOR_NODE: {
+
+                children = within(a,4,extra.size()) && statement_child(extra[a]) && expression_child(extra[a + 1],true)
+                    && expression_child(extra[a + 2],true) && statement_child(extra[a + 3]);
+                break;
+            }
+            case FUNCTION_NODE: children = within(a,5,extra.size()) && statement_child(extra[a + 1]) && within(extra[a + 2],extra[a + 3],parameter_names.size()); break;
+            default: return false; //not a kind flatten writes
+        }
+
+        if(!children || !within_source(tokens[id])) return false;
+    }
+
+    for(auto &name: parameter_names) if(!within_source(name)) return false;
+    for(auto root: roots) if(root != no_node && (root >= nodes || is_expression(root))) return false;
+    return true;
+}
+
+
+class flattener: public tree_visitor<flattener,uint32_t,uint32_t> {
+
+    /* appends a subtree to a flat_tree, children first, and returns the id of its root */
+
+    flat_tree &tree;
+
+    public:
+    flattener(flat_tree &tree): tree(tree) {}
+
+    uint32_t optional(expression* exp) { return exp == NULL ? no_node : visit(exp); }
+    uint32_t optional(statement* stmt) { return stmt == NULL ? no_node : visit(stmt); }
+
+    uint32_t statement_list(const pmr::vector<statement*> &statements) {
+        //flattens a statement list and returns where its ids start in extra
+
+        vector<uint32_t> ids;
+        for(auto stmt: statements) ids.push_back(optional(stmt));
+        return tree.add_extra(ids);
+    }
+
+    uint32_t typed(expression* exp, uint32_t id) {
+
+        tree.expression_types[id] = exp->expression_type;
+        return id;
+    }
+
+    uint32_t resolved(frame_slot binding, uint32_t id) {
+
+        tree.depths[id] = binding.depth;
+        tree.slots[id] = binding.slot;
+        return id;
+    }
+
+    uint32_t sized(uint32_t slot, uint32_t id) {
+        //the slot of a declaration or the frame size of a scope
+
+        tree.slots[id] = slot;
+        return id;
+    }
+
+    uint32_t visit_binary_expression(binary_expression* exp) {
+
+        uint32_t left = visit(exp->left);
+        uint32_t right = visit(exp->right);
+        return typed(exp,tree.add_node(BINARY_NODE,exp->line_number,exp->optr,left,right));
+    }
+    uint32_t visit_logical_expression(logical_expression* exp) {
+
+        uint32_t left = visit(exp->left);
+        uint32_t right = visit(exp->right);
+        return typed(exp,tree.add_node(LOGICAL_NODE,exp->line_number,exp->optr,left,right));
+    }
+    uint32_t visit_unary_expression(unary_expression* exp) { return typed(exp,tree.add_node(UNARY_NODE,exp->line_number,exp->optr,visit(exp->right),no_node)); }
+    uint32_t visit_literal_expression(literal_expression* exp) { return typed(exp,tree.add_node(LITERAL_NODE,exp->line_number,exp->literal,no_node,no_node)); }
+    uint32_t visit_variable_literal_expression(variable_literal_expression* exp) {
+
+        return resolved(exp->binding,typed(exp,tree.add_node(VARIABLE_NODE,exp->line_number,exp->variable_name,no_node,no_node)));
+    }
+    uint32_t visit_function_call_expression(function_call_expression* exp) {
+
+        vector<uint32_t> arguments;
+        for(auto argument: exp->arguments) arguments.push_back(visit(argument));
+        return resolved(exp->binding,typed(exp,tree.add_node(CALL_NODE,exp->line_number,exp->function_name,tree.add_extra(arguments),arguments.size())));
+    }
+
+    uint32_t visit_block_statement(block_statement* stmt) {
+
+        uint32_t statements = statement_list(stmt->statements);
+        token braces(stmt->begin,stmt->end - stmt->begin,LEFT_BRACE,stmt->line_number);
+        return sized(stmt->frame_size,tree.add_node(BLOCK_NODE,stmt->line_number,braces,statements,stmt->statements.size()));
+    }
+    uint32_t visit_expression_statement(expression_statement* stmt) { return tree.add_node(EXPRESSION_STATEMENT_NODE,stmt->line_number,token(),visit(stmt->exp),no_node); }
+    uint32_t visit_print_statement(print_statement* stmt) { return tree.add_node(PRINT_NODE,stmt->line_number,token(),visit(stmt->exp),no_node); }
+    uint32_t visit_return_statement(return_statement* stmt) { return tree.add_node(RETURN_NODE,stmt->line_number,token(),optional(stmt->return_exp),no_node); }
+    uint32_t visit_declaration_statement(declaration_statement* stmt) {
+
+        return sized(stmt->slot,tree.add_node(DECLARATION_NODE,stmt->line_number,stmt->variable_name,optional(stmt->exp),stmt->variable_type));
+    }
+    uint32_t visit_input_statement(input_statement* stmt) {
+
+        return resolved(stmt->binding,tree.add_node(INPUT_NODE,stmt->line_number,stmt->input_reciever_variable,no_node,stmt->input_type));
+    }
+    uint32_t visit_conditional_statement(conditional_statement* stmt) {
+
+        uint32_t condition = visit(stmt->expr);
+        vector<uint32_t> branches = {optional(stmt->if_statements),optional(stmt->else_statements)};
+        return tree.add_node(CONDITIONAL_NODE,stmt->line_number,token(),condition,tree.add_extra(branches));
+    }
+    uint32_t visit_while_statement(while_statement* stmt) {
+
+        uint32_t condition = visit(stmt->expr);
+        uint32_t body = optional(stmt->statements);
+        return tree.add_node(WHILE_NODE,stmt->line_number,token(),condition,body);
+    }
+    uint32_t visit_for_statement(for_statement* stmt) {
+
+        vector<uint32_t> parts;
+        parts.push_back(optional(stmt->part1));
+        parts.push_back(optional(stmt->part2));
+        parts.push_back(optional(stmt->part3));
+        parts.push_back(optional(stmt->statements));
+        return sized(stmt->frame_size,tree.add_node(FOR_NODE,stmt->line_number,token(),tree.add_extra(parts),no_node));
+    }
+    uint32_t visit_function_declaration_statement(function_declaration_statement* stmt) {
+
+        uint32_t body = optional(stmt->block);
+        uint32_t first_parameter = tree.parameter_names.size();
+        for(auto &parameter: stmt->parameters) {
+
+            tree.parameter_names.push_back(parameter.first);
+            tree.parameter_types.push_back(parameter.second);
+        }
+
+        vector<uint32_t> payload = {uint32_t(stmt->return_type),body,first_parameter,uint32_t(stmt->parameters.size()),stmt->frame_size};
+        return sized(stmt->slot,tree.add_node(FUNCTION_NODE,stmt->line_number,stmt->function_name,tree.add_extra(payload),no_node));
+    }
+    uint32_t visit_class_declaration_statement(class_declaration_statement* stmt) {
+
+        uint32_t methods = statement_list(stmt->methods);
+        return tree.add_node(CLASS_NODE,stmt->line_number,stmt->variable_name,methods,stmt->methods.size());
+    }
+
+};
+
+flat_tree ast:: flatten(const vector<statement*> &program) {
+
+    flat_tree tree;
+    flattener builder(tree);
+    for(auto declaration: program) tree.roots.push_back(builder.optional(declaration));
+    return tree;
+}
+
+
+static statement* unflatten_statement(const flat_tree &tree, uint32_t id, ast_arena &arena);
+
+static expression* unflatten_expression_node(const flat_tree &tree, uint32_t id, ast_arena &arena);
+
+static expression* unflatten_expression(const flat_tree &tree, uint32_t id, ast_arena &arena) {
+
+    if(id == no_node) return NULL;
+    return deep_call([&]() { return unflatten_expression_node(tree,id,arena); });
+}
+
+static expression* unflatten_expression_node(const flat_tree &tree, uint32_t id, ast_arena &arena) {
+
+    token main_token = tree.tokens[id];
+    int line_number = tree.line_numbers[id];
+    uint32_t first = tree.first[id], second = tree.second[id];
+
+    expression* exp;
+    switch(tree.kinds[id]) {
+
+        case BINARY_NODE: exp = arena.make<binary_expression>(unflatten_expression(tree,first,arena),main_token,unflatten_expression(tree,second,arena),line_number); break;
+        case LOGICAL_NODE: exp = arena.make<logical_expression>(unflatten_expression(tree,first,arena),main_token,unflatten_expression(tree,second,arena),line_number); break;
+        case UNARY_NODE: exp = arena.make<unary_expression>(main_token,unflatten_expression(tree,first,arena),line_number); break;
+        case LITERAL_NODE: exp = arena.make<literal_expression>(main_token,line_number); break;
+        case VARIABLE_NODE: {
+
+            auto variable = arena.make<variable_literal_expression>(main_token,line_number);
+            variable->binding = frame_slot{tree.depths[id],tree.slots[id]};
+            exp = variable;
+            break;
+        }
+        default: {
+
+            pmr::vector<expression*> arguments(&arena);
+            arguments.reserve(second);
+            for(uint32_t i = 0; i<second; i++) arguments.push_back(unflatten_expression(tree,tree.extra[first + i],arena));
+            auto call = arena.make<function_call_expression>(main_token,std::move(arguments),line_number);
+            call->binding = frame_slot{tree.depths[id],tree.slots[id]};
+            exp = call;
+        }
+    }
+
+    exp->expression_type = tree.expression_types[id];
+    return exp;
+}
+
+static pmr::vector<statement*> unflatten_statements(const flat_tree &tree, uint32_t first, uint32_t count, ast_arena &arena) {
+
+    pmr::vector<statement*> statements(&arena);
+    statements.reserve(count);
+    for(uint32_t i = 0; i<count; i++) statements.push_back(unflatten_statement(tree,tree.extra[first + i],arena));
+    return statements;
+}
+
+static statement* unflatten_statement_node(const flat_tree &tree, uint32_t id, ast_arena &arena);
+
+static statement* unflatten_statement(const flat_tree &tree, uint32_t id, ast_arena &arena) {
+
+    if(id == no_node) return NULL;
+    return deep_call([&]() { return unflatten_statement_node(tree,id,arena); });
+}
+
+static statement* unflatten_statement_node(const flat_tree &tree, uint32_t id, ast_arena &arena) {
+
+    token main_token = tree.tokens[id];
+    int line_number = tree.line_numbers[id];
+    uint32_t first = tree.first[id], second = tree.second[id];
+
+    switch(tree.kinds[id]) {
+
+        case BLOCK_NODE: {
+
+            auto block = arena.make<block_statement>(unflatten_statements(tree,first,second,arena),line_number,main_token.offset,main_token.offset + main_token.length);
+            block->frame_size = tree.slots[id];
+            return block;
+        }
+        case EXPRESSION_STATEMENT_NODE: return arena.make<expression_statement>(unflatten_expression(tree,first,arena),line_number);
+        case PRINT_NODE: return arena.make<print_statement>(unflatten_expression(tree,first,arena),line_number);
+        case RETURN_NODE: return arena.make<return_statement>(unflatten_expression(tree,first,arena),line_number);
+        case DECLARATION_NODE: {
+
+            auto declaration = arena.make<declaration_statement>(unflatten_expression(tree,first,arena),main_token,token_type(second),line_number);
+            declaration->slot = tree.slots[id];
+            return declaration;
+        }
+        case INPUT_NODE: {
+
+            auto input = arena.make<input_statement>(main_token,token_type(second),line_number);
+            input->binding = frame_slot{tree.depths[id],tree.slots[id]};
+            return input;
+        }
+        case CONDITIONAL_NODE: {
+
+            statement* if_statements = unflatten_statement(tree,tree.extra[second],arena);
+            statement* else_statements = unflatten_statement(tree,tree.extra[second + 1],arena);
+            return arena.make<conditional_statement>(unflatten_expression(tree,first,arena),if_statements,else_statements,line_number);
+        }
+        case WHILE_NODE: return arena.make<while_statement>(unflatten_expression(tree,first,arena),unflatten_statement(tree,second,arena),line_number);
+        case FOR_NODE: {
+
+            statement* part1 = unflatten_statement(tree,tree.extra[first],arena);
+            expression* part2 = unflatten_expression(tree,tree.extra[first + 1],arena);
+            expression* part3 = unflatten_expression(tree,tree.extra[first + 2],arena);
+            auto loop = arena.make<for_statement>(part1,part2,part3,unflatten_statement(tree,tree.extra[first + 3],arena),line_number);
+            loop->frame_size = tree.slots[id];
+            return loop;
+        }
+        case FUNCTION_NODE: {
+
+            uint32_t first_parameter = tree.extra[first + 2], parameter_count = tree.extra[first + 3];
+            pmr::vector<pair<token,token_type>> parameters(&arena);
+            parameters.reserve(parameter_count);
+            for(uint32_t i = first_parameter; i<first_parameter + parameter_count; i++) parameters.push_back({tree.parameter_names[i],tree.parameter_types[i]});
+
+            statement* body = unflatten_statement(tree,tree.extra[first + 1],arena);
+            auto function = arena.make<function_declaration_statement>(main_token,std::move(parameters),body,token_type(tree.extra[first]),line_number);
+            function->slot = tree.slots[id];
+            function->frame_size = tree.extra[first + 4];
+            return function;
+        }
+        default: return arena.make<class_declaration_statement>(main_token,unflatten_statements(tree,first,second,arena),line_number);
+    }
+}
+
+vector<statement*> ast:: unflatten(const flat_tree &tree, ast_arena &arena) {
+
+    vector<statement*> program;
+    for(auto root: tree.roots) program.push_back(unflatten_statement(tree,root,arena));
+    return program;
+}
@@ -0,0 +1,97 @@
+//flat_ast.h
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <cstdint>
+#include <vector>
+#include "ast.h"
+
+namespace ast {
+
+const uint32_t no_node = UINT32_MAX; //an absent child: for loop parts, else branches, empty returns
+
+class flat_tree {
+
+    /* the AST as parallel arrays indexed by node id instead of pointer linked objects. Children are stored before
+     * their parents and every node has a kind, a line, a main token and two 32 bit operands:
+     *
+     *   BINARY, LOGICAL             token operator, first left, second right
+     *   UNARY                       token operator, first operand
+     *   LITERAL, VARIABLE           token literal or name
+     *   CALL                        token name, first index of the arguments in extra, second argument count
+     *   EXPRESSION_STATEMENT, PRINT first expression
+     *   RETURN                      first expression or no_node
+     *   DECLARATION                 token variable, first initialiser, second variable type
+     *   INPUT                       token receiving variable, second input type
+     *   BLOCK                       token offset and length span the braces, first index of the statements in extra, second count
+     *   CONDITIONAL                 first condition, second index in extra of [then branch, else branch or no_node]
+     *   WHILE                       first condition, second body
+     *   FOR                         first index in extra of [initialiser, condition, step, body], absent parts are no_node
+     *   FUNCTION                    token name, first index in extra of [return type, body, first parameter, parameter count, frame size]
+     *   CLASS                       token name, first index of the methods in extra, second method count
+     *
+     * Parameters live in their own two columns. Expressions keep the type semantic_analyser inferred for them in
+     * expression_types, statements have ERROR there. What the analyser resolved goes in depths and slots: the frame_slot
+     * of a VARIABLE, CALL and INPUT, the slot of a DECLARATION and FUNCTION, and the frame size of a BLOCK and FOR in
+     * slots. Every other entry is 0 */
+
+    public:
+    std::vector<node_kind> kinds; //the same tags the pointer nodes carry
+    std::vector<int> line_numbers;
+    std::vector<tok::token> tokens;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> second;
+    std::vector<uint32_t> extra;
+    std::vector<tok::token_type> expression_types;
+    std::vector<uint32_t> depths;
+    std::vector<uint32_t> slots;
+    std::vector<tok::token> parameter_names;
+    std::vector<tok::token_type> parameter_types;
+    std::vector<uint32_t> roots; //the top level declarations in source order
+
+    uint32_t add_node(node_kind kind, int line_number, tok::token main_token, uint32_t first, uint32_t second);
+    uint32_t add_extra(const std::vector<uint32_t> &values);
+    size_t size() const;
+    size_t bytes() const; //memory taken by the columns
+
+    /* whether the columns are what flatten could have written for a source of source_size bytes: known kinds, children
+     * of the right sort stored before their parents, extra and parameter ranges inside their columns and tokens inside
+     * the source. unflatten and visit_children trust all of it, so anything read back from disk is checked first */
+    bool well_formed(size_t source_size) const;
+
+    //calls visit(child id) for every present child of a node, in source order
+    template<class function_type>
+    void visit_children(uint32_t id, function_type &&visit) const {
+
+        uint32_t a = first[id], b = second[id];
+        auto visit_present = [&](uint32_t child) { if(child != no_node) visit(child); };
+
+        switch(kinds[id]) {
+
+            case BINARY_NODE: case LOGICAL_NODE: visit_present(a); visit_present(b); break;
+            case UNARY_NODE: case EXPRESSION_STATEMENT_NODE: case PRINT_NODE: case RETURN_NODE: case DECLARATION_NODE: visit_present(a); break;
+            case CALL_NODE: case BLOCK_NODE: case CLASS_NODE: for(uint32_t i = a; i<a + b; i++) visit_present(extra[i]); break;
+            case CONDITIONAL_NODE: visit_present(a); visit_present(extra[b]); visit_present(extra[b + 1]); break;
+            case WHILE_NODE: visit_present(a); visit_present(b); break;
+            case FOR_NODE: for(uint32_t i = a; i<a + 4; i++) visit_present(extra[i]); break;
+            case FUNCTION_NODE: visit_present(extra[a + 1]); break;
+            default: break;
+        }
+    }
+
+};
+
+flat_tree flatten(const std::vector<statement*> &program);
+
+/* rebuilds pointer nodes from the columns. This is the only way semantic_analyser, the interpreter and the compilers
+ * get at a flat tree: they are written once, against the pointer nodes, and a second copy of the analysis over the
+ * columns would have to be kept in step with the first for every rule. So analysing a flat tree round-trips through
+ * pointer nodes, and costs a rebuild on top of the analysis rather than saving one. What the flat encoding is for is
+ * storage: it is the layout the on-disk cache in cache.h writes and maps back in, and the cheap walk visit_children
+ * gives over it. The rebuilt nodes carry the types and slots recorded in the columns, so a cached program needs no
+ * second analysis */
+std::vector<statement*> unflatten(const flat_tree &tree, ast_arena &arena);
+
+}
+
+#endif
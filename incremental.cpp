@@ -0,0 +1,347 @@
+#include "incremental.h"
+#include "parser.h"
+#include "scanner.h"
+#include "string_pool.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace tok;
+using namespace ast;
+
+
+class position_visitor: public tree_visitor<position_visitor,void,void> {
+
+    /* hands every token, node line number and block offset of a subtree to the callbacks, in source order */
+
+    const function<void(token&)> &on_token;
+    const function<void(int&)> &on_line;
+    const function<void(uint32_t&)> &on_offset;
+
+    public:
+    position_visitor(const function<void(token&)> &on_token, const function<void(int&)> &on_line, const function<void(uint32_t&)> &on_offset):
+        on_token(on_token), on_line(on_line), on_offset(on_offset) {}
+
+    void optional(expression* exp) { if(exp != NULL) visit(exp); }
+    void optional(statement* stmt) { if(stmt != NULL) visit(stmt); }
+
+    void visit_binary_expression(binary_expression* exp) { on_line(exp->line_number); visit(exp->left); on_token(exp->optr); visit(exp->right); }
+    void visit_logical_expression(logical_expression* exp) { visit_binary_expression(exp); }
+    void visit_unary_expression(unary_expression* exp) { on_line(exp->line_number); on_token(exp->optr); visit(exp->right); }
+    void visit_literal_expression(literal_expression* exp) { on_line(exp->line_number); on_token(exp->literal); }
+    void visit_variable_literal_expression(variable_literal_expression* exp) { on_line(exp->line_number); on_token(exp->variable_name); }
+    void visit_function_call_expression(function_call_expression* exp) {
+
+        on_line(exp->line_number);
+        on_token(exp->function_name);
+        for(auto argument: exp->arguments) visit(argument);
+    }
+
+    void visit_block_statement(block_statement* stmt) {
+
+        on_line(stmt->line_number);
+        on_offset(stmt->begin);
+        for(auto inner: stmt->statements) optional(inner);
+        on_offset(stmt->end);
+    }
+    void visit_conditional_statement(conditional_statement* stmt) {
+
+        on_line(stmt->line_number);
+        visit(stmt->expr);
+        optional(stmt->if_statements);
+        optional(stmt->else_statements);
+    }
+    void visit_while_statement(while_statement* stmt) { on_line(stmt->line_number); visit(stmt->expr); optional(stmt->statements); }
+    void visit_for_statement(for_statement* stmt) {
+
+        on_line(stmt->line_number);
+        optional(stmt->part1);
+        optional(stmt->part2);
+        optional(stmt->part3);
+        optional(stmt->statements);
+    }
+    void visit_expression_statement(expression_statement* stmt) { on_line(stmt->line_number); visit(stmt->exp); }
+    void visit_declaration_statement(declaration_statement* stmt) { on_line(stmt->line_number); on_token(stmt->variable_name); optional(stmt->exp); }
+    void visit_print_statement(print_statement* stmt) { on_line(stmt->line_number); visit(stmt->exp); }
+    void visit_input_statement(input_statement* stmt) { on_line(stmt->line_number); on_token(stmt->input_reciever_variable); }
+    void visit_return_statement(return_statement* stmt) { on_line(stmt->line_number); optional(stmt->return_exp); }
+    void visit_function_declaration_statement(function_declaration_statement* stmt) {
+
+        on_line(stmt->line_number);
+        on_token(stmt->function_name);
+        for(auto &parameter: stmt->parameters) on_token(parameter.first);
+        optional(stmt->block);
+    }
+    void visit_class_declaration_statement(class_declaration_statement* stmt) {
+
+        on_line(stmt->line_number);
+        on_token(stmt->variable_name);
+        for(auto method: stmt->methods) optional(method);
+    }
+
+};
+
+void ast:: visit_positions(statement* stmt, const function<void(token&)> &on_token, const function<void(int&)> &on_line, const function<void(uint32_t&)> &on_offset) {
+
+    position_visitor(on_token,on_line,on_offset).optional(stmt);
+}
+
+static void find_enclosing_blocks(statement* stmt, size_t begin, size_t end, vector<block_statement*> &blocks) {
+    //collects the blocks whose braces strictly surround [begin, end), outermost first
+
+    if(stmt == NULL) return;
+
+    deep_call([&]() {
+
+        switch(stmt->kind) {
+
+            case BLOCK_NODE: {
+
+                auto block = static_cast<block_statement*>(stmt);
+                if(block->begin >= begin || end >= block->end) return;
+                blocks.push_back(block);
+                for(auto inner: block->statements) find_enclosing_blocks(inner,begin,end,blocks);
+                break;
+            }
+            case CONDITIONAL_NODE: {
+
+                auto conditional = static_cast<conditional_statement*>(stmt);
+                find_enclosing_blocks(conditional->if_statements,begin,end,blocks);
+                find_enclosing_blocks(conditional->else_statements,begin,end,blocks);
+                break;
+            }
+            case WHILE_NODE: find_enclosing_blocks(static_cast<while_statement*>(stmt)->statements,begin,end,blocks); break;
+            case FOR_NODE: find_enclosing_blocks(static_cast<for_statement*>(stmt)->statements,begin,end,blocks); break;
+            case FUNCTION_NODE: find_enclosing_blocks(static_cast<function_declaration_statement*>(stmt)->block,begin,end,blocks); break;
+            case CLASS_NODE: for(auto method: static_cast<class_declaration_statement*>(stmt)->methods) find_enclosing_blocks(method,begin,end,blocks); break;
+            default: break;
+        }
+    });
+}
+
+
+incremental_parser:: incremental_parser(string text): source(std::move(text)) {
+
+    parse_everything();
+}
+
+const source_buffer& incremental_parser:: get_source() const {
+
+    return this->source;
+}
+
+void incremental_parser:: parse_everything() {
+
+    declarations.clear();
+    arena.release();
+    source.number_literals.clear();
+    scan::scanner scan(source);
+    parser p(scan,source,arena);
+    vector<statement*> nodes = p.parse_program();
+
+    for(size_t i = 0; i<nodes.size(); i++) {
+
+        declaration_span &span = p.declaration_spans[i];
+        declarations.push_back(incremental_declaration{span.begin,span.end,span.line_number,nodes[i],0,0});
+    }
+
+    this->errors = p.errors;
+    this->error_status = p.error_status;
+    this->reparsed_bytes = source.size();
+    this->full_parse_bytes = arena.bytes_used();
+    this->full_parse_literals = source.number_literals.size();
+}
+
+bool incremental_parser:: collect_garbage() const {
+
+    size_t added_bytes = arena.bytes_used() - full_parse_bytes;
+    size_t added_literals = source.number_literals.size() - full_parse_literals;
+    return added_bytes >= max(full_parse_bytes,min_garbage_bytes) || added_literals * sizeof(double) >= max(full_parse_literals * sizeof(double),min_garbage_bytes);
+}
+
+void incremental_parser:: apply_shift(incremental_declaration &declaration) {
+
+    if(declaration.offset_shift == 0 && declaration.line_shift == 0) return;
+
+    int64_t offset_shift = declaration.offset_shift;
+    int line_shift = declaration.line_shift;
+    visit_positions(declaration.node,
+        [&](token &t) { t.offset += offset_shift; t.line_number += line_shift; },
+        [&](int &line_number) { line_number += line_shift; },
+        [&](uint32_t &offset) { offset += offset_shift; });
+
+    declaration.offset_shift = 0;
+    declaration.line_shift = 0;
+}
+
+int incremental_parser:: line_at(size_t offset) {
+    //line number of an offset in front of the edit, counted from the closest declaration which starts before it
+
+    auto after = partition_point(declarations.begin(),declarations.end(),[&](const incremental_declaration &d) { return d.begin <= offset; });
+    const char* text = source.data();
+
+    if(after == declarations.begin()) return 1 + count(text,text + offset,'\n');
+
+    auto &closest = *(after - 1);
+    return closest.line_number + count(text + closest.begin,text + offset,'\n');
+}
+
+void incremental_parser:: edit(size_t offset, size_t removed, string_view inserted) {
+
+    offset = min(offset,source.size());
+    removed = min(removed,source.size() - offset);
+
+    const char* text = source.data();
+    bool same_lines = memchr(text + offset,'\n',removed) == NULL && inserted.find('\n') == string_view::npos;
+    bool incremental = !error_status && !collect_garbage();
+
+    if(incremental && same_lines) {
+
+        //a declaration strictly around the edit may get away with re-parsing one of its blocks
+        auto after = partition_point(declarations.begin(),declarations.end(),[&](const incremental_declaration &d) { return d.begin < offset; });
+        if(after != declarations.begin() && offset + removed < (after - 1)->end) {
+
+            if(reparse_block(*(after - 1),offset,removed,inserted)) return;
+        }
+    }
+
+    if(incremental && reparse_lines(offset,removed,inserted)) return;
+
+    source.replace(offset,removed,inserted);
+    parse_everything();
+}
+
+bool incremental_parser:: reparse_block(incremental_declaration &declaration, size_t offset, size_t removed, string_view inserted) {
+
+    apply_shift(declaration);
+
+    vector<block_statement*> blocks;
+    find_enclosing_blocks(declaration.node,offset,offset + removed,blocks);
+    if(blocks.empty()) return false;
+
+    int64_t delta = int64_t(inserted.size()) - int64_t(removed);
+    string removed_text(source.view(offset,removed));
+    source.replace(offset,removed,inserted);
+
+    for(size_t i = blocks.size(); i-- > 0;) {
+        //innermost block first. Its braces are untouched, so scanning between them starts and ends in a clean state
+
+        block_statement* block = blocks[i];
+        size_t range_end = block->end + delta;
+        scan::scanner scan(source,block->begin,range_end,block->line_number,global_string_pool(),source.number_literals);
+        parser p(scan,source,arena);
+
+        block_statement* fresh = NULL;
+        try {
+
+            fresh = static_cast<block_statement*>(p.parse_block_statement());
+        }
+        catch(string error) {
+
+            continue;
+        }
+
+        if(p.error_status || p.peak().type != END_OF_FILE || fresh->end != range_end) continue;
+
+        //move everything behind the block, then adopt the new contents. Line numbers are unchanged
+        uint32_t old_end = block->end;
+        visit_positions(declaration.node,
+            [&](token &t) { if(t.offset >= old_end) t.offset += delta; },
+            [&](int &) {},
+            [&](uint32_t &position) { if(position >= old_end) position += delta; });
+        block->statements = fresh->statements;
+        declaration.end += delta;
+
+        for(auto following = &declaration + 1; following != declarations.data() + declarations.size(); following++) {
+
+            following->begin += delta;
+            following->end += delta;
+            following->offset_shift += delta;
+        }
+
+        reparsed_bytes = range_end - block->begin;
+        return true;
+    }
+
+    //no block re-parsed cleanly, undo the edit for the next attempt
+    source.replace(offset,inserted.size(),removed_text);
+    return false;
+}
+
+bool incremental_parser:: reparse_lines(size_t offset, size_t removed, string_view inserted) {
+    /* re-parses whole lines: the lines of the edit, grown until they cover every declaration they overlap.
+     * Strings and comments end with their line, so the scanner starts and stops in a clean state */
+
+    const char* text = source.data();
+    size_t size = source.size();
+    auto line_start = [&](size_t position) { while(position > 0 && text[position - 1] != '\n') position--; return position; };
+    auto line_end = [&](size_t position) {
+        const void* newline = memchr(text + position,'\n',size - position);
+        return newline == NULL ? size : static_cast<const char*>(newline) - text + 1;
+    };
+
+    size_t begin = line_start(offset);
+    size_t end = line_end(offset + removed);
+    size_t first, last;
+    while(true) {
+
+        first = partition_point(declarations.begin(),declarations.end(),[&](const incremental_declaration &d) { return d.end <= begin; }) - declarations.begin();
+        last = partition_point(declarations.begin(),declarations.end(),[&](const incremental_declaration &d) { return d.begin < end; }) - declarations.begin();
+        if(first >= last) break;
+
+        size_t grown_begin = min(begin,line_start(declarations[first].begin));
+        size_t grown_end = max(end,line_end(declarations[last - 1].end));
+        if(grown_begin == begin && grown_end == end) break;
+        begin = grown_begin;
+        end = grown_end;
+    }
+
+    int first_line = line_at(begin);
+    int64_t delta = int64_t(inserted.size()) - int64_t(removed);
+    int line_delta = count(inserted.begin(),inserted.end(),'\n') - count(text + offset,text + offset + removed,'\n');
+    string removed_text(source.view(offset,removed));
+    source.replace(offset,removed,inserted);
+
+    scan::scanner scan(source,begin,end + delta,first_line,global_string_pool(),source.number_literals);
+    parser p(scan,source,arena);
+    vector<statement*> nodes = p.parse_program();
+    if(p.error_status) {
+
+        source.replace(offset,inserted.size(),removed_text);
+        return false;
+    }
+
+    for(size_t i = last; i<declarations.size(); i++) {
+
+        declarations[i].begin += delta;
+        declarations[i].end += delta;
+        declarations[i].line_number += line_delta;
+        declarations[i].offset_shift += delta;
+        declarations[i].line_shift += line_delta;
+    }
+
+    vector<incremental_declaration> fresh;
+    for(size_t i = 0; i<nodes.size(); i++) {
+
+        declaration_span &span = p.declaration_spans[i];
+        fresh.push_back(incremental_declaration{span.begin,span.end,span.line_number,nodes[i],0,0});
+    }
+
+    declarations.erase(declarations.begin() + first,declarations.begin() + last);
+    declarations.insert(declarations.begin() + first,fresh.begin(),fresh.end());
+    reparsed_bytes = end + delta - begin;
+    return true;
+}
+
+vector<statement*> incremental_parser:: program() {
+    //the whole AST, with the positions of every declaration brought up to date
+
+    vector<statement*> nodes;
+    for(auto &declaration: declarations) {
+
+        apply_shift(declaration);
+        nodes.push_back(declaration.node);
+    }
+
+    return nodes;
+}
@@ -0,0 +1,71 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "source.h"
+
+namespace ast {
+
+    //calls back for every token, every node line number and every block offset below stmt, in source order
+    void visit_positions(statement* stmt, const std::function<void(tok::token&)> &on_token, const std::function<void(int&)> &on_line, const std::function<void(uint32_t&)> &on_offset);
+
+}
+
+class incremental_declaration {
+
+    /* a top level declaration of an incremental_parser. The spans are always current. The AST lags behind by
+     * offset_shift and line_shift, edits before the declaration only bump these and the nodes are fixed up on demand */
+
+    public:
+    uint32_t begin;
+    uint32_t end;
+    int line_number;
+    ast::statement* node;
+    int64_t offset_shift;
+    int line_shift;
+
+};
+
+const size_t min_garbage_bytes = 1 << 20;
+
+class incremental_parser {
+
+    /* front end for the editor integration. It owns the source text and its AST and takes text edits: an edit is
+     * re-scanned and re-parsed inside the smallest enclosing block statement when it leaves the line structure alone,
+     * otherwise inside the whole lines of the top level declarations it touches. The rest of the AST is reused.
+     * Syntax errors make the next edits re-parse the whole file, so diagnostics always match a batch run.
+     * Re-parses only ever add nodes to the arena and values to the number literal table. Once they have added as much
+     * as the last full parse left behind, and at least min_garbage_bytes, the next edit re-parses the whole file and
+     * starts both afresh, so an editor session stays within a constant factor of the size of its AST. Identifiers are
+     * interned into the global string pool, which only grows with names never seen before */
+
+    tok::source_buffer source;
+    ast::ast_arena arena; //subtrees replaced by an edit stay here until the next full parse
+    std::vector<incremental_declaration> declarations;
+    size_t full_parse_bytes = 0; //arena bytes and number literals right after the last full parse
+    size_t full_parse_literals = 0;
+
+    void parse_everything();
+    bool collect_garbage() const; //whether the next edit should re-parse everything to reclaim what re-parses left behind
+    void apply_shift(incremental_declaration &declaration);
+    bool reparse_block(incremental_declaration &declaration, size_t offset, size_t removed, std::string_view inserted);
+    bool reparse_lines(size_t offset, size_t removed, std::string_view inserted);
+    int line_at(size_t offset);
+
+    public:
+    bool error_status = false;
+    std::vector<std::string> errors;
+    size_t reparsed_bytes = 0; //size of the source range the last edit re-parsed
+
+    incremental_parser(std::string text);
+    void edit(size_t offset, size_t removed, std::string_view inserted);
+    std::vector<ast::statement*> program();
+    const tok::source_buffer& get_source() const;
+
+};
+
+#endif
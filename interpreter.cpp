@@ -0,0 +1,262 @@
+#include "interpreter.h"
+
+using namespace ast;
+using namespace std;
+using namespace tok;
+
+
+const uint32_t no_frame = UINT32_MAX; //the parent of the global frame
+
+interpreter:: interpreter(const source_buffer &source, ostream &out, istream &in): source(source), out(out), in(in) {}
+
+void interpreter:: run(const vector<statement*> &program) {
+
+    slots.clear();
+    frames.clear();
+    call_depth = 0;
+    returning = false;
+    push_frame(top_level_frame_size(program),no_frame);
+    for(auto stmt: program) {
+
+        visit(stmt);
+        if(returning) break;
+    }
+    pop_frame();
+    out.flush();
+}
+
+value& interpreter:: slot_at(frame_slot binding) {
+
+    uint32_t frame = frames.size() - 1;
+    for(uint32_t depth = 0; depth<binding.depth; depth++) frame = frames[frame].parent;
+    return slots[frames[frame].base + binding.slot];
+}
+
+value& interpreter:: local_slot(uint32_t slot) {
+
+    return slots[frames.back().base + slot];
+}
+
+void interpreter:: push_frame(uint32_t size, uint32_t parent) {
+
+    frames.push_back(frame_record{uint32_t(slots.size()),parent});
+    slots.resize(slots.size() + size);
+}
+
+void interpreter:: pop_frame() {
+
+    slots.resize(frames.back().base);
+    frames.pop_back();
+}
+
+void interpreter:: run_statements(const pmr::vector<statement*> &statements) {
+
+    for(auto stmt: statements) {
+
+        visit(stmt);
+        if(returning) return;
+    }
+}
+
+string interpreter:: runtime_error(int line_number, const string &message) const {
+
+    return "RUNTIME ERROR at line " + to_string(line_number) + " : " + message;
+}
+
+
+void interpreter:: visit_conditional_statement(conditional_statement* stmt) {
+
+    if(visit(stmt->expr).truthy()) visit(stmt->if_statements);
+    else if(stmt->else_statements != NULL) visit(stmt->else_statements);
+}
+
+void interpreter:: visit_block_statement(block_statement* stmt) {
+
+    push_frame(stmt->frame_size,frames.size() - 1);
+    run_statements(stmt->statements);
+    pop_frame();
+}
+
+void interpreter:: visit_while_statement(while_statement* stmt) {
+
+    while(visit(stmt->expr).truthy()) {
+
+        visit(stmt->statements);
+        if(returning) return;
+    }
+}
+
+void interpreter:: visit_for_statement(for_statement* stmt) {
+    //the header and a block body share the loop's frame, like they share a scope in semantic_analyser
+
+    push_frame(stmt->frame_size,frames.size() - 1);
+    if(stmt->part1 != NULL) visit(stmt->part1);
+    while(stmt->part2 == NULL || visit(stmt->part2).truthy()) {
+
+        if(stmt->statements->kind == BLOCK_NODE) run_statements(static_cast<block_statement*>(stmt->statements)->statements);
+        else visit(stmt->statements);
+        if(returning) break;
+        if(stmt->part3 != NULL) visit(stmt->part3);
+    }
+    pop_frame();
+}
+
+void interpreter:: visit_expression_statement(expression_statement* stmt) {
+
+    visit(stmt->exp);
+}
+
+void interpreter:: visit_declaration_statement(declaration_statement* stmt) {
+
+    value initial = stmt->exp == NULL ? value() : visit(stmt->exp);
+    local_slot(stmt->slot) = std::move(initial);
+}
+
+void interpreter:: visit_print_statement(print_statement* stmt) {
+
+    out<<visit(stmt->exp)<<'\n';
+}
+
+void interpreter:: visit_input_statement(input_statement* stmt) {
+
+    string line;
+    if(!getline(in,line)) throw runtime_error(stmt->line_number,"no input left for \"" + string(stmt->input_reciever_variable.lexeme(source)) + "\"");
+
+    if(stmt->input_type == STRING_TYPE) {
+
+        slot_at(stmt->binding) = value(std::move(line));
+        return;
+    }
+
+    double number;
+    if(!parse_number(line,number)) throw runtime_error(stmt->line_number,"\"" + line + "\" is not a number");
+    slot_at(stmt->binding) = value(number);
+}
+
+void interpreter:: visit_return_statement(return_statement* stmt) {
+
+    return_value = stmt->return_exp == NULL ? value() : visit(stmt->return_exp);
+    returning = true;
+}
+
+void interpreter:: visit_function_declaration_statement(function_declaration_statement* stmt) {
+
+    local_slot(stmt->slot) = value(callable{stmt,uint32_t(frames.size() - 1)});
+}
+
+void interpreter:: visit_class_declaration_statement(class_declaration_statement* stmt) {
+    //classes are not analysed yet, so there is nothing to run
+}
+
+
+value interpreter:: visit_binary_expression(binary_expression* exp) {
+
+    token_type optr = exp->optr.type;
+    if(optr == EQUAL) {
+        //the parser only builds assignments to a variable
+
+        value assigned = visit(exp->right);
+        return slot_at(static_cast<variable_literal_expression*>(exp->left)->binding) = std::move(assigned);
+    }
+
+    value left = visit(exp->left);
+    value right = visit(exp->right);
+    if(left.is_number() && right.is_number()) {
+
+        double a = left.number(), b = right.number();
+        switch(optr) {
+
+            case PLUS: return value(a + b);
+            case MINUS: return value(a - b);
+            case STAR: return value(a * b);
+            case SLASH: return value(a / b);
+            case LESS: return value(double(a < b));
+            case LESS_EQUAL: return value(double(a <= b));
+            case GREATER: return value(double(a > b));
+            case GREATER_EQUAL: return value(double(a >= b));
+            case EQUAL_EQUAL: return value(double(a == b));
+            case BANG_EQUAL: return value(double(a != b));
+            default: break;
+        }
+    }
+
+    if(optr == EQUAL_EQUAL) return value(double(left.equals(right)));
+    if(optr == BANG_EQUAL) return value(double(!left.equals(right)));
+
+    if(left.kind() == STRING_VALUE && right.kind() == STRING_VALUE) {
+
+        if(optr == PLUS) return concatenate(left,right);
+        const string &a = left.text(), &b = right.text();
+        switch(optr) {
+
+            case LESS: return value(double(a < b));
+            case LESS_EQUAL: return value(double(a <= b));
+            case GREATER: return value(double(a > b));
+            case GREATER_EQUAL: return value(double(a >= b));
+            default: break;
+        }
+    }
+
+    throw runtime_error(exp->line_number,"Invalid operands " + string(left.kind_name()) + " and " + right.kind_name() + " to operator " + string(exp->optr.lexeme(source)));
+}
+
+value interpreter:: visit_logical_expression(logical_expression* exp) {
+    //and and or give back the operand which decided them, the right one is only evaluated when it is needed
+
+    value left = visit(exp->left);
+    if(exp->optr.type == OR ? left.truthy() : !left.truthy()) return left;
+    return visit(exp->right);
+}
+
+value interpreter:: visit_unary_expression(unary_expression* exp) {
+
+    value operand = visit(exp->right);
+    if(exp->optr.type == BANG) return value(double(!operand.truthy()));
+    if(!operand.is_number()) throw runtime_error(exp->line_number,"Invalid operand " + string(operand.kind_name()) + " to operator -");
+    return value(-operand.number());
+}
+
+value interpreter:: visit_literal_expression(literal_expression* exp) {
+
+    switch(exp->literal.type) {
+
+        case NUMBER_TYPE: return value(exp->literal.number_literal_value(source));
+        case STRING_TYPE: return interned_strings().intern(exp->literal.string_literal_value(source));
+        case TRUE: return value(true);
+        case FALSE: return value(false);
+        default: return value();
+    }
+}
+
+value interpreter:: visit_variable_literal_expression(variable_literal_expression* exp) {
+
+    return slot_at(exp->binding);
+}
+
+value interpreter:: visit_function_call_expression(function_call_expression* exp) {
+
+    value callee = slot_at(exp->binding);
+    if(callee.kind() != FUNCTION_VALUE) throw runtime_error(exp->line_number,string(callee.kind_name()) + " is not a function");
+    auto function = static_cast<const function_declaration_statement*>(callee.function().code);
+    if(call_depth == max_call_depth) throw runtime_error(exp->line_number,"Stack overflow, calls nest deeper than " + to_string(max_call_depth));
+
+    //the arguments become the parameters, the first slots of the new frame. Calls among them leave the stack as they found it
+    uint32_t base = slots.size();
+    for(auto argument: exp->arguments) {
+
+        value parameter = visit(argument);
+        slots.push_back(std::move(parameter));
+    }
+    slots.resize(base + function->frame_size);
+    frames.push_back(frame_record{base,callee.function().frame});
+
+    call_depth++;
+    visit(function->block);
+    call_depth--;
+    pop_frame();
+
+    value result = std::move(return_value);
+    return_value = value();
+    returning = false;
+    return result;
+}
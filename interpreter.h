@@ -0,0 +1,73 @@
+//interpreter.h
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "value.h"
+
+namespace ast {
+
+class frame_record {
+
+    public:
+    uint32_t base; //index of the frame's first slot on the slot stack
+    uint32_t parent; //the frame around it in the source: the enclosing one for a block, the declaring one for a call
+
+};
+
+class interpreter: public tree_visitor<interpreter,value> {
+
+    /* runs an analysed program. Every scope is an array of slots on one stack, as many as the frame_size the analyser
+     * recorded, and a name is read from the slot it was resolved to, depth parent links out from the innermost frame.
+     * Calls are native: the arguments are evaluated straight into the first slots of the callee's frame, whose parent
+     * is the frame the function was declared in, and the body runs on the C++ stack. A return unwinds through the
+     * returning flag rather than an exception. Run time errors are thrown as strings */
+
+    const tok::source_buffer &source;
+    std::ostream &out;
+    std::istream &in;
+    std::vector<value> slots;
+    std::vector<frame_record> frames;
+    uint32_t call_depth = 0;
+    bool returning = false;
+    value return_value;
+
+    value& slot_at(frame_slot binding);
+    value& local_slot(uint32_t slot); //in the innermost frame
+    void push_frame(uint32_t size, uint32_t parent);
+    void pop_frame();
+    void run_statements(const std::pmr::vector<statement*> &statements);
+    std::string runtime_error(int line_number, const std::string &message) const;
+
+    public:
+    interpreter(const tok::source_buffer &source, std::ostream &out = std::cout, std::istream &in = std::cin);
+    void run(const std::vector<statement*> &program);
+
+    void visit_conditional_statement(conditional_statement* stmt);
+    void visit_block_statement(block_statement* stmt);
+    void visit_while_statement(while_statement* stmt);
+    void visit_for_statement(for_statement* stmt);
+    void visit_expression_statement(expression_statement* stmt);
+    void visit_declaration_statement(declaration_statement* stmt);
+    void visit_print_statement(print_statement* stmt);
+    void visit_input_statement(input_statement* stmt);
+    void visit_return_statement(return_statement* stmt);
+    void visit_function_declaration_statement(function_declaration_statement* stmt);
+    void visit_class_declaration_statement(class_declaration_statement* stmt);
+
+    value visit_binary_expression(binary_expression* exp);
+    value visit_logical_expression(logical_expression* exp);
+    value visit_unary_expression(unary_expression* exp);
+    value visit_literal_expression(literal_expression* exp);
+    value visit_variable_literal_expression(variable_literal_expression* exp);
+    value visit_function_call_expression(function_call_expression* exp);
+
+};
+
+}
+
+#endif
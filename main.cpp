@@ -1,10 +1,18 @@
 #include "ast.h"
+#include "cache.h"
+#include "flat_ast.h"
+#include "interpreter.h"
+#include "register_vm.h"
+#include "vm.h"
 #include "scanner.h"
 #include "parser.h"
 #include <any>
 #include<iostream>
 #include <memory>
-#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 using namespace scan;
@@ -14,25 +22,122 @@ using namespace ast;
 
 void bruh(int a) {}
 
+static int run_program(const parsed_program &program, const cached_program &cached, const tok::source_buffer &source, const string &engine) {
+    //only a program which went through the front end without a single diagnostic runs
+
+    if(program.error_status || !cached.diagnostics.empty()) return 0;
+    try {
+
+        if(engine == "interpreter") {
+
+            interpreter machine(source);
+            machine.run(program.declarations);
+        }
+        else if(engine == "register") {
+
+            register_program compiled = compile_registers(program.declarations,source);
+            register_machine machine(compiled);
+            machine.run();
+        }
+        else {
+
+            bytecode_program compiled = compile_program(program.declarations,source);
+            virtual_machine machine(compiled);
+            machine.run();
+        }
+    }
+    catch(string error) {
+
+        cout<<error<<endl;
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
 
-    ifstream source_code;
-    source_code.open(argv[1],ios::in);
-    string source = "";
-    string temp = "";
-    while(getline(source_code,temp)) {
-        source += temp;
-        source += '\n';
+    /* alox [-j threads] [--cache-dir directory | --no-cache] [--engine vm | register | interpreter] [file]. Source files
+     * are mapped and scanned in place. Without a file argument (or with "-") the program is streamed from stdin.
+     * Programs run on the stack bytecode VM unless the register VM or the tree walking interpreter is asked for */
+    size_t jobs = 1;
+    string engine = "vm";
+    const char* path = NULL;
+    string cache_directory = program_cache::default_directory();
+    for(int i = 1; i<argc; i++) {
+
+        string argument = argv[i];
+        if(argument == "-j" && i+1 < argc) jobs = strtoul(argv[++i],NULL,10);
+        else if(argument == "--cache-dir" && i+1 < argc) cache_directory = argv[++i];
+        else if(argument == "--no-cache") cache_directory = "";
+        else if(argument == "--engine" && i+1 < argc) engine = argv[++i];
+        else path = argv[i];
+    }
+
+    int source_file = STDIN_FILENO;
+    if(path != NULL && string(path) != "-") {
+
+        source_file = open(path,O_RDONLY);
+        if(source_file < 0) {
+
+            cout<<"ERROR: could not open \""<<path<<"\""<<endl;
+            return 1;
+        }
+    }
+
+    tok::source_buffer source_text(source_file);
+    if(source_file != STDIN_FILENO) close(source_file); //the mapping stays valid after the descriptor is closed
+
+    parsed_program program;
+    program_cache cache(cache_directory);
+    cached_program cached;
+
+    if(cache.load(source_text,cached)) {
+        //this text was analysed before: replay its diagnostics and rebuild the tree without running the front end
+
+        for(auto &diagnostic: cached.diagnostics) cout<<diagnostic<<endl;
+        program.arenas.emplace_back(new ast::ast_arena());
+        program.declarations = unflatten(cached.tree,*program.arenas.back());
+        program.error_status = cached.error_status;
+        return run_program(program,cached,source_text,engine);
     }
-    source_code.close();
-    scanner scan(source);
-    auto tokens = scan.scan_source_code();
-    parser p(tokens);
-    auto tree = p.parse_program();
-    if(p.error_status == false) {
 
-        semantic_analyser sa(tree);
-        sa.analyse_program();
+    scanner scan(source_text);
+    unique_ptr<thread_pool> pool;
+
+    if(jobs > 1) {
+        /* scan the whole file in parallel first, then parse its top level declarations in parallel. On a lexical error
+         * the lazy scanner takes over, so diagnostics do not depend on -j */
+
+        pool = make_unique<thread_pool>(jobs);
+        try {
+
+            vector<tok::token> tokens = scan_source_code_parallel(source_text,*pool,pool->size() * 4);
+            program = parse_program_parallel(std::move(tokens),source_text,*pool,pool->size() * 4);
+        }
+        catch(string error) {
+
+            source_text.number_literals.clear();
+        }
+    }
+
+    if(program.arenas.empty()) {
+        //tokens are scanned lazily while parsing, into one arena which owns the tree until main returns
+
+        program.arenas.emplace_back(new ast::ast_arena());
+        parser p(scan,source_text,*program.arenas.back());
+        program.declarations = p.parse_program();
+        program.errors = p.errors;
+        program.error_status = p.error_status;
+    }
+
+    for(auto &error: program.errors) cout<<error<<endl;
+    cached.diagnostics = program.errors;
+
+    if(program.error_status == false) {
+
+        semantic_analyser sa(program.declarations,source_text);
+        if(pool) sa.analyse_program_parallel(*pool,pool->size() * 4);
+        else sa.analyse_program();
 
         if(!sa.error_stack.empty()) {
 
@@ -40,7 +145,16 @@ int main(int argc, char** argv) {
                 cout<<at<<endl;
             }
         }
+        cached.diagnostics.insert(cached.diagnostics.end(),sa.error_stack.begin(),sa.error_stack.end());
     }
 
-    return 0;
+    if(!cache_directory.empty()) {
+        //with --no-cache there is nowhere to store the tree, so it is not flattened either
+
+        cached.tree = flatten(program.declarations);
+        cached.error_status = program.error_status;
+        cache.store(source_text,cached);
+    }
+
+    return run_program(program,cached,source_text,engine);
 }
@@ -2,6 +2,8 @@
 #include "environment.h"
 #include "token.h"
 #include "ast.h"
+#include "scanner.h"
+#include <array>
 #include <iostream>
 #include <unordered_set>
 
@@ -12,167 +14,140 @@ using namespace ast;
 
 
 
-token_type get_type(token type_word) {
+token_type get_type(token type_word, const source_buffer &source) {
 
-
-    if(type_word.lexeme == "Void") return tok::VOID_TYPE;
-    if(type_word.lexeme == "Number") return tok::NUMBER_TYPE;
-    if(type_word.lexeme == "String") return tok::STRING_TYPE;
+    string_view type_name = type_word.lexeme(source);
+    if(type_name == "Void") return tok::VOID_TYPE;
+    if(type_name == "Number") return tok::NUMBER_TYPE;
+    if(type_name == "String") return tok::STRING_TYPE;
+    return tok::ERROR;
 
 }
 
-parser:: parser(vector<token> &tokens) {
+parser:: parser(scan::token_stream &tokens, const source_buffer &source, ast_arena &arena): tokens(tokens), source(source), arena(arena) {
     this->current = 0;
-    this->tokens = tokens;
-}
-
-
-
-
-expression* parser:: parse_expression() {
-    return this->parse_assignment();
-
-}
-expression * parser :: parse_assignment() {
-
-
-    expression * left = parse_logical_or();
-
-    if(typeid((*left)) == typeid(variable_literal_expression)) {
 
+    try {
 
-        if(match(EQUAL)) {
-
-            auto tok = consume_token(EQUAL);
-            expression * expr = parse_assignment();
-            left = new binary_expression(left,tok,expr,tok.line_number);
-            return left;
-
-        }
-
+        this->advance(); //fill the lookahead window with the first token
     }
+    catch(string error) {
 
-    return left;
-
-
-}
-
-expression *parser:: parse_logical_or() {
-
-    expression *left = parse_logical_and();
-
-    while(match(OR)) {
-
-        auto tok = consume_token(OR);
-        expression *expr = parse_logical_and();
-        left = new logical_expression(left,tok,expr,tok.line_number);
-
+        errors.push_back(error);
+        error_status = true;
     }
-
-
-    return left;
-
-
-
 }
 
-expression *parser:: parse_logical_and() {
-
-    expression *left = parse_equality();
+void parser:: advance() {
+    /* slides the lookahead window by one token. Tokens are pulled from the token stream on demand and dropped once
+     * they fall out of the window, so the parser never holds more than two of them */
 
-    while(match(AND)) {
+    previous_token = current_token;
+    ++current;
 
-        auto tok = consume_token(AND);
-        expression *expr = parse_equality();
-        left = new logical_expression(left,tok,expr,tok.line_number);
+    try {
 
+        current_token = tokens.next_token();
     }
+    catch(string error) {
 
-    return left;
-
+        //the scanner has already skipped the malformed lexeme. Leave an ERROR token behind for synchronise to step over
+        current_token = token(previous_token.offset + previous_token.length,0,tok::ERROR,tokens.get_line_number());
+        throw;
+    }
 }
 
 
 
-expression* parser:: parse_equality() {
 
+typedef enum {
+    /* binding strength of the binary operators, weakest first. EQUAL_EQUAL binds like a comparison and BANG_EQUAL
+     * one level weaker, as in the grammar this parser started from */
+    NO_PRECEDENCE,
+    ASSIGNMENT_PRECEDENCE,
+    OR_PRECEDENCE,
+    AND_PRECEDENCE,
+    EQUALITY_PRECEDENCE,
+    COMPARISON_PRECEDENCE,
+    TERM_PRECEDENCE,
+    FACTOR_PRECEDENCE
 
-    expression *left = parse_comparison();
-    unordered_set<token_type> valid_operators = {BANG_EQUAL,EQUAL_EQUAL};
+} precedence;
 
-    while(match(valid_operators)) {
+class binary_operator {
 
-        token optr = get_operator(); //will increment by current by and return operator token. put this comment in get_operator() function
-        expression *right = parse_comparison();
-        left = new binary_expression(left,optr,right,optr.line_number);
+    public:
+    uint8_t precedence;
+    bool right_associative;
+    bool logical; //builds a logical_expression instead of a binary_expression
 
-    }
+};
 
-    return left;
+constexpr array<binary_operator,tok::ERROR+1> build_binary_operators() {
 
+    array<binary_operator,tok::ERROR+1> operators{};
+    operators[EQUAL] = {ASSIGNMENT_PRECEDENCE,true,false};
+    operators[OR] = {OR_PRECEDENCE,false,true};
+    operators[AND] = {AND_PRECEDENCE,false,true};
+    operators[BANG_EQUAL] = {EQUALITY_PRECEDENCE,false,false};
+    operators[EQUAL_EQUAL] = {COMPARISON_PRECEDENCE,false,false};
+    operators[GREATER] = {COMPARISON_PRECEDENCE,false,false};
+    operators[GREATER_EQUAL] = {COMPARISON_PRECEDENCE,false,false};
+    operators[LESS] = {COMPARISON_PRECEDENCE,false,false};
+    operators[LESS_EQUAL] = {COMPARISON_PRECEDENCE,false,false};
+    operators[PLUS] = {TERM_PRECEDENCE,false,false};
+    operators[MINUS] = {TERM_PRECEDENCE,false,false};
+    operators[STAR] = {FACTOR_PRECEDENCE,false,false};
+    operators[SLASH] = {FACTOR_PRECEDENCE,false,false};
+    return operators;
 }
 
+constexpr array<binary_operator,tok::ERROR+1> binary_operators = build_binary_operators();
 
-expression* parser:: parse_comparison() {
-    expression *left = parse_addsub();
-    unordered_set<token_type> valid_operators = {GREATER,GREATER_EQUAL,LESS,LESS_EQUAL,EQUAL_EQUAL};
 
+expression* parser:: parse_expression() {
 
-    while(match(valid_operators)) {
-
-        token optr = get_operator(); //will increment by current by and return operator token. put this comment in get_operator() function
-        expression *right = parse_addsub();
-        left = new binary_expression(left,optr,right,optr.line_number);
-
-    }
-
-    return left;
+    return this->parse_binary(ASSIGNMENT_PRECEDENCE);
 
 }
 
-expression* parser:: parse_addsub() {
-
-    expression *left = parse_multdiv();
-    unordered_set<token_type> valid_operators = {PLUS,MINUS};
-
+expression* parser:: parse_binary(int minimum_precedence) {
+    /* precedence climbing over the binary_operators table: parses a unary expression, then keeps folding in
+     * operators that bind at least as strongly as minimum_precedence. Parenthesised and right associative
+     * operands recurse through here, so it goes through deep_call */
 
-    while(match(valid_operators)) {
+    return deep_call([&]() {
 
-        token optr = get_operator(); //will increment by current by and return operator token. put this comment in get_operator() function
-        expression *right = parse_multdiv();
-        left = new binary_expression(left,optr,right,optr.line_number);
+        expression *left = parse_unary();
 
-    }
-
-    return left;
-
-}
+        while(true) {
 
-expression* parser:: parse_multdiv() {
+            token_type type = current_token.type;
+            const binary_operator &optr_rule = binary_operators[type];
+            if(optr_rule.precedence == NO_PRECEDENCE || optr_rule.precedence < minimum_precedence) break;
 
-    expression *left = parse_unary();
-    unordered_set<token_type> valid_operators = {STAR,SLASH};
+            //only a plain variable can be assigned to, anything else leaves the = for the caller to reject
+            if(type == EQUAL && left->kind != VARIABLE_NODE) break;
 
-    while(match(valid_operators)) {
+            token optr = get_operator();
+            expression *right = parse_binary(optr_rule.right_associative ? optr_rule.precedence : optr_rule.precedence + 1);
 
-        token optr = get_operator(); //will increment by current by and return operator token. put this comment in get_operator() function
-        expression *right = parse_unary();
-        left = new binary_expression(left,optr,right,optr.line_number);
-
-    }
-
-    return left;
+            if(optr_rule.logical) left = arena.make<logical_expression>(left,optr,right,optr.line_number);
+            else left = arena.make<binary_expression>(left,optr,right,optr.line_number);
+        }
 
+        return left;
+    });
 
 }
 
 expression* parser:: parse_unary() {
 
-    unordered_set<token_type> valid_types = {BANG,MINUS};
-    while(match(valid_types)) {
+    if(match(BANG) || match(MINUS)) {
+
         token optr = get_operator();
-        expression *right = parse_unary();
-        return new unary_expression(optr,right,optr.line_number);
+        expression *right = deep_call([&]() { return parse_unary(); });
+        return arena.make<unary_expression>(optr,right,optr.line_number);
     }
 
     return parse_call();
@@ -183,117 +158,97 @@ expression *parser:: parse_call() {
 
 
     expression *exp = parse_literal();
-    vector<expression*> arguments;
-
-    int line_number = -1;
 
-    if(typeid((*exp)) == typeid(variable_literal_expression)) {
+    if(match(LEFT_PAREN) && exp->kind == VARIABLE_NODE) {
 
+        consume_token(LEFT_PAREN); //will be later replaced by outer while loop for multiple calls
+        vector<expression*> arguments;
 
-        if(match(LEFT_PAREN)) {
-            consume_token(LEFT_PAREN); //will be later replaced by outer while loop for multiple calls
+        if(!match(RIGHT_PAREN)) { //implies there is an argument given
 
-            if(!match(RIGHT_PAREN)) { //implies there is an argument given
+            arguments.push_back(parse_expression());
+            while(!match(RIGHT_PAREN)) {
 
+                consume_token(COMMA);
                 arguments.push_back(parse_expression());
-                while(!match(RIGHT_PAREN)) {
-
-                    consume_token(COMMA);
-                    arguments.push_back(parse_expression());
-
 
-                }
 
             }
 
-            line_number = consume_token(RIGHT_PAREN).line_number;
-
         }
-    }
 
-    if(line_number != -1) {
-        expression * call_expr = new function_call_expression(static_cast<variable_literal_expression*>(exp)->get_variable_name(),arguments,line_number);
-        return call_expr;
+        int line_number = consume_token(RIGHT_PAREN).line_number;
+        return arena.make<function_call_expression>(static_cast<variable_literal_expression*>(exp)->get_variable_name(),arena.copy(arguments),line_number);
 
     }
-    else
-    {
-
-        return exp;
 
-    }
+    return exp;
 
 }
 expression* parser:: parse_literal() {
 
-    unordered_set<token_type> valid_types = {IDENTIFIER,NUMBER_TYPE,STRING_TYPE,TRUE,FALSE,NIL};
-
-    if(match(valid_types)) {
+    switch(current_token.type) {
 
-        token literal_obj = get_literal();
-        if(literal_obj.type == IDENTIFIER) {
-            expression *litvarexp = new variable_literal_expression(literal_obj,literal_obj.line_number);
-            return litvarexp;
+        case IDENTIFIER: {
 
+            token literal_obj = get_literal();
+            return arena.make<variable_literal_expression>(literal_obj,literal_obj.line_number);
         }
-        else
-        {
-            expression* litexpr = new literal_expression(literal_obj,literal_obj.line_number);
-            return litexpr;
-
+        case NUMBER_TYPE:
+        case STRING_TYPE:
+        case TRUE:
+        case FALSE:
+        case NIL: {
+
+            token literal_obj = get_literal();
+            return arena.make<literal_expression>(literal_obj,literal_obj.line_number);
         }
-    }
-    else if(tokens[current].type == LEFT_PAREN)
-    {
-        current++; //consume the opening (
-        expression *expr =  parse_expression(); //expression inside (expression)
+        case LEFT_PAREN: {
 
-        if(tokens[current].type != RIGHT_PAREN)
-        {
-            //error, expected ). TODO: need to dry run how this error will look like
+            advance(); //consume the opening (
+            expression *expr =  parse_expression(); //expression inside (expression)
+            consume_token(RIGHT_PAREN);
+            return expr;
         }
+        default: {
 
-        return expr;
-    }
-    else
-    {
-        int current_line_number  = tokens[current].line_number;
-        string error = "ERROR at line " +to_string(current_line_number) + ": Expected expression" ;
-        throw  error;
-
+            int current_line_number  = current_token.line_number;
+            string error = "ERROR at line " +to_string(current_line_number) + ": Expected expression" ;
+            throw  error;
+        }
     }
 }
 
 bool parser:: match(unordered_set<token_type> &valid_types) {
 
-    return valid_types.count(tokens[current].type);
+    return valid_types.count(current_token.type);
 
 }
 bool parser :: match(token_type tt) {
 
-    return tokens[current].type == tt;
+    return current_token.type == tt;
 }
 
 token parser:: get_operator() {
 
-    token optr = tokens[current];
-    ++current;
+    token optr = current_token;
+    advance();
     return optr;
 }
 
 token parser:: get_literal() {
-    token literal = tokens[current];
-    ++current;
+    token literal = current_token;
+    advance();
     return literal;
 }
 
 
 token parser:: consume_token(unordered_set<token_type> &valid_types) {
 
-    token literal = tokens[current];
+    token literal = current_token;
     if(valid_types.count(literal.type)) {
 
-        current++;
+        advance();
         return literal;
     }
     else
@@ -305,20 +260,20 @@ token parser:: consume_token(unordered_set<token_type> &valid_types) {
 }
 token parser:: peak() {
     //simply returns the current token, does not consume it (current remains where it is)
-    return tokens[current];
+    return current_token;
 
 }
 token parser:: consume_token(token_type valid_type) {
 
-    token tk = tokens[current];
+    token tk = current_token;
     if(valid_type == tk.type) {
 
-        current++;
+        advance();
         return tk;
     }
     else
     {
-        string token_error = (valid_type == tok::IDENTIFIER? "identifier" : enum_transalator.at(valid_type));
+        string token_error(enum_transalator.at(valid_type));
 
         string error = "ERROR at line: " +to_string(tk.line_number) + " Expected token \"" + token_error + "\"";
         throw  error;
@@ -332,7 +287,12 @@ vector<statement*> parser:: parse_program() {
 
     while(!match(END_OF_FILE)) {
 
+        declaration_span span;
+        span.begin = current_token.offset;
+        span.line_number = current_token.line_number;
         declarations.push_back(parse_declaration());
+        span.end = previous_token.offset + previous_token.length;
+        declaration_spans.push_back(span);
 
     }
 
@@ -349,7 +309,7 @@ statement* parser:: parse_return_statement() {
     expression *expr = parse_expression();
     consume_token(SEMICOLON);
 
-    auto rtsmt = new return_statement(expr,line_number);
+    auto rtsmt = arena.make<return_statement>(expr,line_number);
     return rtsmt;
 
 
@@ -360,18 +320,26 @@ void parser:: synchronise() {
 
     while(!match(tok::END_OF_FILE)) {
 
-        if(tokens[current-1].type == SEMICOLON) return;
+        if(previous_token.type == SEMICOLON) return;
 
         unordered_set<token_type> statement_start = {FUN,WHILE,FOR,VAR,CLASS,INPUT_NUMBER,INPUT_STRING,PRINT,IF,RETURN,INPUT_NUMBER,INPUT_STRING};
-        if(statement_start.count(tokens[current].type)) return;
+        if(statement_start.count(current_token.type)) return;
+
+        try {
+
+            advance();
+        }
+        catch(string error) {
 
-        current++;
+            errors.push_back(error);
+        }
 
     }
 
 }
 statement* parser:: parse_declaration() {
 
+    int first_token = current;
 
     try {
 
@@ -379,12 +347,12 @@ statement* parser:: parse_declaration() {
 
             int line_number = consume_token(VAR).line_number;
             consume_token(COLON);
-            token_type variable_type = get_type(consume_token(TYPE));
+            token_type variable_type = get_type(consume_token(TYPE),source);
 
             auto variable_name = peak();
             expression *exp = parse_expression();
 
-            statement * declaration_stmt = new declaration_statement(exp,variable_name,variable_type,line_number);
+            statement * declaration_stmt = arena.make<declaration_statement>(exp,variable_name,variable_type,line_number);
 
             consume_token(SEMICOLON);
 
@@ -411,11 +379,27 @@ statement* parser:: parse_declaration() {
     }
     catch(string error) {
 
-        cout<<error<<endl;
-        this->synchronise();
+        errors.push_back(error);
         error_status = true;
 
+        //a declaration which failed on its first token would fail on it again forever, so step over that token
+        if(current == first_token && !match(END_OF_FILE)) {
+
+            try {
+
+                advance();
+            }
+            catch(string error) {
+
+                errors.push_back(error);
+            }
+        }
+
+        this->synchronise();
+
     }
+
+    return NULL; //the program is not analysed once error_status is set, so the hole is never visited
 }
 
 
@@ -435,18 +419,18 @@ statement* parser:: parse_statement() {
     else if(match(IF)) {
 
 
-        return parse_conditional_statement();
+        return deep_call([&]() { return parse_conditional_statement(); }); //bodies nest without braces as well
 
     }
     else if(match(WHILE)) {
 
 
-        return parse_while_statement();
+        return deep_call([&]() { return parse_while_statement(); });
     }
     else if(match(FOR)) {
 
 
-        return parse_for_statement();
+        return deep_call([&]() { return parse_for_statement(); });
     }
     else if(match(RETURN)) {
 
@@ -484,7 +468,7 @@ statement * parser:: parse_number_input_statement() {
     token input_reciever = consume_token(tok::IDENTIFIER);
     consume_token(tok::SEMICOLON);
 
-    auto number_input_stmt = new input_statement(input_reciever,tok::NUMBER_TYPE,input_reciever.line_number);
+    auto number_input_stmt = arena.make<input_statement>(input_reciever,tok::NUMBER_TYPE,input_reciever.line_number);
     return number_input_stmt;
 
 
@@ -497,7 +481,7 @@ statement * parser:: parse_string_input_statement() {
     token input_reciever = consume_token(tok::IDENTIFIER);
     consume_token(tok::SEMICOLON);
 
-    auto str_input_stmt = new input_statement(input_reciever,tok::STRING_TYPE,input_reciever.line_number);
+    auto str_input_stmt = arena.make<input_statement>(input_reciever,tok::STRING_TYPE,input_reciever.line_number);
     return str_input_stmt;
 
 
@@ -538,7 +522,7 @@ statement* parser:: parse_for_statement() {
     int line_number = consume_token(RIGHT_PAREN).line_number;
     statements = parse_statement();
 
-    statement * for_stmt = new for_statement(part1,part2,part3,statements,line_number);
+    statement * for_stmt = arena.make<for_statement>(part1,part2,part3,statements,line_number);
     return for_stmt;
 
 }
@@ -551,7 +535,7 @@ statement* parser:: parse_while_statement() {
 
     statement * statements = parse_statement();
 
-    statement *whilestmt = new while_statement(expr,statements,line_number);
+    statement *whilestmt = arena.make<while_statement>(expr,statements,line_number);
     return whilestmt;
 
 }
@@ -573,23 +557,23 @@ statement* parser::  parse_conditional_statement() {
 
     }
 
-    statement* ifstmt = new conditional_statement(expr,ifstatements,elsestatement,line_number);
+    statement* ifstmt = arena.make<conditional_statement>(expr,ifstatements,elsestatement,line_number);
     return ifstmt;
 }
 
 statement * parser:: parse_block_statement() {
 
-    int line_number = consume_token(LEFT_BRACE).line_number;
+    token left_brace = consume_token(LEFT_BRACE);
     vector<statement*> statements;
 
-    while(!match(RIGHT_BRACE)) {
+    while(!match(RIGHT_BRACE) && !match(END_OF_FILE)) { //an unterminated block ends at the end of the file
 
-        statements.push_back(parse_declaration());
+        statements.push_back(deep_call([&]() { return parse_declaration(); }));
     }
 
-    consume_token(RIGHT_BRACE);
+    token right_brace = consume_token(RIGHT_BRACE);
 
-    statement* block = new block_statement(statements,line_number);
+    statement* block = arena.make<block_statement>(arena.copy(statements),left_brace.line_number,left_brace.offset,right_brace.offset + right_brace.length);
     return block;
 
 }
@@ -602,7 +586,7 @@ statement* parser:: parse_print_statement() {
     expression* exp = parse_expression();
     int line_number = consume_token(SEMICOLON).line_number;
 
-    statement* ps = new print_statement(exp,line_number);
+    statement* ps = arena.make<print_statement>(exp,line_number);
     return ps;
 
 }
@@ -613,7 +597,7 @@ statement* parser:: parse_expression_statement() {
     expression* exp = parse_expression();
     int line_number = consume_token(SEMICOLON).line_number;
 
-    statement *ex = new expression_statement(exp,line_number);
+    statement *ex = arena.make<expression_statement>(exp,line_number);
     return ex;
 }
 
@@ -623,7 +607,7 @@ pair<token,token_type> parser:: parse_function_parameter() {
     consume_token(COLON);
 
     pair<token,token_type> parameter;
-    parameter.second = get_type(consume_token(TYPE));
+    parameter.second = get_type(consume_token(TYPE),source);
     parameter.first = consume_token(tok::IDENTIFIER);
 
     return parameter;
@@ -655,10 +639,10 @@ statement* parser:: parse_function_declaration_statement() {
     consume_token(RIGHT_PAREN);
     consume_token(COLON);
     unordered_set<token_type> valid_types = {TYPE,VOID_TYPE};
-    token_type return_type = get_type(consume_token(valid_types));
+    token_type return_type = get_type(consume_token(valid_types),source);
     statement* statements = parse_block_statement();
 
-    statement* fndec_stmt = new function_declaration_statement(function_name,parameters,statements, return_type,line_number);
+    statement* fndec_stmt = arena.make<function_declaration_statement>(function_name,arena.copy(parameters),statements, return_type,line_number);
 
 
     return fndec_stmt;
@@ -687,10 +671,10 @@ statement* parser:: parse_class_method() {
 
     consume_token(RIGHT_PAREN);
     consume_token(COLON);
-    token_type return_type = get_type(consume_token(TYPE));
+    token_type return_type = get_type(consume_token(TYPE),source);
     statement* statements = parse_block_statement();
 
-    statement* fndec_stmt = new function_declaration_statement(function_name,parameters,statements, return_type,function_name.line_number);
+    statement* fndec_stmt = arena.make<function_declaration_statement>(function_name,arena.copy(parameters),statements, return_type,function_name.line_number);
 
     return fndec_stmt;
 
@@ -704,15 +688,96 @@ statement* parser::  parse_class_declaration_statement() {
 
     vector<statement*> methods;
 
-    while(!match(tok::RIGHT_BRACE)) {
+    while(!match(tok::RIGHT_BRACE) && !match(tok::END_OF_FILE)) {
 
         methods.push_back(parse_class_method());
 
     }
 
     consume_token(tok::RIGHT_BRACE);
-    statement * class_declaration_stmt = new class_declaration_statement(class_name,methods,class_name.line_number);
+    statement * class_declaration_stmt = arena.make<class_declaration_statement>(class_name,arena.copy(methods),class_name.line_number);
     return class_declaration_stmt;
 
 }
 
+
+
+// PARALLEL PARSING
+
+static vector<size_t> top_level_starts(const vector<token> &tokens) {
+    /* token indices where a top level declaration probably starts: behind a semicolon or a closing brace outside of
+     * any bracket, unless an else carries the statement on. This is only a guess, the parse of every chunk checks it */
+
+    vector<size_t> starts = {0};
+    int depth = 0;
+
+    for(size_t i = 0; i + 1 < tokens.size(); i++) {
+
+        token_type type = tokens[i].type;
+        if(type == LEFT_PAREN || type == LEFT_BRACE) depth++;
+        else if(type == RIGHT_PAREN || type == RIGHT_BRACE) depth--;
+
+        if(depth < 0) return {0}; //unbalanced, the sequential parse reports it
+        token_type next = tokens[i+1].type;
+        if(depth == 0 && (type == SEMICOLON || type == RIGHT_BRACE) && next != ELSE && next != END_OF_FILE) starts.push_back(i+1);
+    }
+
+    return starts;
+}
+
+static void parse_tokens(parsed_program &result, vector<token> tokens, const source_buffer &source) {
+    //parses a token range ending in END_OF_FILE into a fresh arena of result
+
+    scan::token_buffer stream(std::move(tokens));
+    result.arenas.emplace_back(new ast_arena());
+    parser p(stream,source,*result.arenas.back());
+
+    result.declarations = p.parse_program();
+    result.declaration_spans = std::move(p.declaration_spans);
+    result.errors = std::move(p.errors);
+    result.error_status = p.error_status;
+}
+
+parsed_program parse_program_parallel(vector<token> tokens, const source_buffer &source, thread_pool &pool, size_t chunk_count) {
+    /* cuts the token stream into chunks of whole top level declarations and parses them concurrently, each into an
+     * arena of its own. A top level declaration does not depend on the ones before it, so the chunks can simply be
+     * concatenated in source order. A chunk with a syntax error may come from a wrong cut, and synchronise would
+     * recover differently at a chunk start than in one pass, so then the whole program is parsed again in one pass */
+
+    vector<size_t> starts = top_level_starts(tokens);
+    size_t chunk_size = tokens.size() / max(chunk_count,size_t(1)) + 1;
+
+    vector<size_t> boundaries = {0};
+    for(size_t start: starts) {
+
+        if(start - boundaries.back() >= chunk_size) boundaries.push_back(start);
+    }
+    boundaries.push_back(tokens.size() - 1); //the END_OF_FILE token
+    size_t chunks = boundaries.size() - 1;
+
+    vector<parsed_program> results(chunks);
+    pool.parallel_for(chunks,[&](size_t chunk) {
+
+        vector<token> chunk_tokens(tokens.begin() + boundaries[chunk],tokens.begin() + boundaries[chunk+1]);
+        const token &next = tokens[boundaries[chunk+1]];
+        chunk_tokens.push_back(token(next.offset,0,END_OF_FILE,next.line_number));
+        parse_tokens(results[chunk],std::move(chunk_tokens),source);
+    });
+
+    parsed_program program;
+    for(auto &result: results) {
+
+        if(result.error_status) {
+
+            parsed_program sequential;
+            parse_tokens(sequential,std::move(tokens),source);
+            return sequential;
+        }
+
+        program.declarations.insert(program.declarations.end(),result.declarations.begin(),result.declarations.end());
+        program.declaration_spans.insert(program.declaration_spans.end(),result.declaration_spans.begin(),result.declaration_spans.end());
+        program.arenas.push_back(std::move(result.arenas.front()));
+    }
+
+    return program;
+}
@@ -1,32 +1,46 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <memory>
 #include <vector>
 #include<unordered_set>
 #include "token.h"
 #include "ast.h"
+#include "scanner.h"
 
 
 
+class declaration_span {
+
+    /* where a top level declaration starts and ends in the source, recorded by parse_program */
+
+    public:
+    uint32_t begin; //offset of the first token
+    uint32_t end; //offset just past the last token
+    int line_number; //line of the first token
+
+};
+
 class parser{
     
-    /*Every rule of the grammar is a seperate function. Recursive descent */
+    /*Every rule of the grammar is a seperate function. Recursive descent, with precedence climbing for binary operators */
     private:
-    std::vector<tok::token> tokens;
+    scan::token_stream &tokens;
+    const tok::source_buffer &source;
+    ast::ast_arena &arena; //every node is allocated here, the tree lives as long as the arena
+    tok::token previous_token; //lookahead window: the last consumed token and the one under the cursor
+    tok::token current_token;
     bool inside_function = false;
-    int current;
+    int current; //number of tokens consumed so far
 
     public:
     bool error_status = false;
-    parser(std::vector<tok::token> &tokens);
+    std::vector<std::string> errors; //syntax errors in the order they were found, the driver prints them
+    std::vector<declaration_span> declaration_spans;
+    parser(scan::token_stream &tokens, const tok::source_buffer &source, ast::ast_arena &arena);
+    void advance();
     ast::expression* parse_expression();
-    ast::expression* parse_assignment();
-    ast::expression* parse_logical_or();
-    ast::expression* parse_logical_and();
-    ast::expression* parse_equality();
-    ast::expression* parse_comparison();
-    ast::expression* parse_addsub();
-    ast::expression* parse_multdiv();
+    ast::expression* parse_binary(int minimum_precedence);
     ast::expression* parse_unary();
     ast::expression* parse_literal();
     ast::expression* parse_call();
@@ -59,7 +73,22 @@ class parser{
 
 };
 
+class parsed_program {
+
+    /* the result of parse_program_parallel. The declarations are spread over one arena per chunk, they live as long
+     * as this object */
+
+    public:
+    std::vector<ast::statement*> declarations;
+    std::vector<declaration_span> declaration_spans;
+    std::vector<std::string> errors;
+    bool error_status = false;
+    std::vector<std::unique_ptr<ast::ast_arena>> arenas;
+
+};
 
+//parses the top level declarations of a scanned program concurrently, with the same result and diagnostics as parse_program
+parsed_program parse_program_parallel(std::vector<tok::token> tokens, const tok::source_buffer &source, thread_pool &pool, size_t chunk_count);
 
 #endif
 
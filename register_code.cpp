@@ -0,0 +1,417 @@
+#include "register_code.h"
+#include <algorithm>
+#include <utility>
+
+using namespace ast;
+using namespace std;
+using namespace tok;
+
+
+const uint32_t no_register = UINT32_MAX;
+
+static uint32_t operator_index(token_type optr) {
+    //position of the operator in REG_ADD ... REG_NOT_EQUAL, the comparisons from 4 on
+
+    switch(optr) {
+
+        case PLUS: return 0;
+        case MINUS: return 1;
+        case STAR: return 2;
+        case SLASH: return 3;
+        case LESS: return 4;
+        case LESS_EQUAL: return 5;
+        case GREATER: return 6;
+        case GREATER_EQUAL: return 7;
+        case EQUAL_EQUAL: return 8;
+        default: return 9;
+    }
+}
+
+static bool comparison(token_type optr) {
+
+    return optr == LESS || optr == LESS_EQUAL || optr == GREATER || optr == GREATER_EQUAL || optr == EQUAL_EQUAL || optr == BANG_EQUAL;
+}
+
+static bool pure(expression* exp) {
+    //whether evaluating exp can not assign a variable
+
+    switch(exp->kind) {
+
+        case LITERAL_NODE: case VARIABLE_NODE: return true;
+        case UNARY_NODE: return pure(static_cast<unary_expression*>(exp)->right);
+        case LOGICAL_NODE: return pure(static_cast<logical_expression*>(exp)->left) && pure(static_cast<logical_expression*>(exp)->right);
+        case BINARY_NODE: {
+
+            auto binary = static_cast<binary_expression*>(exp);
+            return binary->optr.type != EQUAL && pure(binary->left) && pure(binary->right);
+        }
+        default: return false;
+    }
+}
+
+class register_compiler: public tree_visitor<register_compiler,uint32_t,void> {
+
+    /* emits the code of one function at a time. Expressions return the operand their value is in: the register of a
+     * local variable is used in place, a literal is a constant operand, anything else goes to the register the caller
+     * asked for in destination or to a temporary. Temporaries start above the slots of the open scopes and are given
+     * back at every statement */
+
+    register_program &program;
+    const source_buffer &source;
+    frame_layout layout;
+    constant_pool constants;
+    uint32_t function = 0; //index of the function being compiled
+    uint32_t next_temporary = 0;
+    uint32_t destination = no_register;
+
+    register_function& chunk() { return program.functions[function]; }
+
+    uint32_t emit(register_opcode op, int line_number, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) {
+        //returns where the instruction is, for the jumps
+
+        register_function &code = chunk();
+        code.mark(code.code.size(),line_number);
+        code.code.push_back(register_instruction{op,a,b,c});
+        return code.code.size() - 1;
+    }
+
+    void jump_to(uint32_t jump, uint32_t target) {
+
+        chunk().code[jump].a = uint32_t(int32_t(target) - int32_t(jump + 1));
+    }
+
+    void patch_jump(uint32_t jump) {
+        //points a forward jump at the next instruction
+
+        jump_to(jump,chunk().code.size());
+    }
+
+    uint32_t temporary() {
+
+        uint32_t reg = next_temporary++;
+        chunk().register_count = max(chunk().register_count,next_temporary);
+        return reg;
+    }
+
+    bool is_variable(uint32_t operand) const {
+
+        return !(operand & constant_operand) && operand < layout.next_slot;
+    }
+
+    uint32_t result_register() {
+
+        return destination != no_register ? destination : temporary();
+    }
+
+    uint32_t compile_expression(expression* exp, uint32_t target = no_register) {
+        //compiles exp, into target when there is one
+
+        uint32_t outer_destination = destination;
+        destination = target;
+        uint32_t result = visit(exp);
+        destination = outer_destination;
+        if(target == no_register || result == target) return result;
+
+        emit(REG_MOVE,exp->line_number,target,result);
+        return target;
+    }
+
+    pair<uint32_t,uint32_t> operands(expression* left, expression* right) {
+        //a variable on the left is read in place, unless the right operand may assign it before the operator runs
+
+        uint32_t left_operand = compile_expression(left);
+        if(is_variable(left_operand) && !pure(right)) {
+
+            uint32_t copy = temporary();
+            emit(REG_MOVE,left->line_number,copy,left_operand);
+            left_operand = copy;
+        }
+        return {left_operand,compile_expression(right)};
+    }
+
+    uint32_t condition(expression* exp, bool jump_when) {
+        //emits a jump taken when exp is jump_when, for the caller to point somewhere
+
+        next_temporary = layout.next_slot;
+        if(exp->kind == UNARY_NODE && static_cast<unary_expression*>(exp)->optr.type == BANG) return condition(static_cast<unary_expression*>(exp)->right,!jump_when);
+
+        if(exp->kind == BINARY_NODE && comparison(static_cast<binary_expression*>(exp)->optr.type)) {
+
+            auto compared = static_cast<binary_expression*>(exp);
+            auto both = operands(compared->left,compared->right);
+            uint32_t first = jump_when ? REG_JUMP_IF_LESS : REG_JUMP_UNLESS_LESS;
+            return emit(register_opcode(first + operator_index(compared->optr.type) - 4),exp->line_number,0,both.first,both.second);
+        }
+
+        uint32_t truth = compile_expression(exp);
+        return emit(jump_when ? REG_JUMP_IF_TRUE : REG_JUMP_IF_FALSE,exp->line_number,0,truth);
+    }
+
+    void load(frame_slot binding, uint32_t target, int line_number) {
+
+        slot_address address = layout.locate(binding);
+        if(address.hops == 0) emit(REG_MOVE,line_number,target,address.slot);
+        else if(address.global) emit(REG_GET_GLOBAL,line_number,target,address.slot);
+        else emit(REG_GET_OUTER,line_number,target,address.hops,address.slot);
+    }
+
+    void store(frame_slot binding, uint32_t operand, int line_number) {
+
+        slot_address address = layout.locate(binding);
+        if(address.hops == 0) {
+
+            if(operand != address.slot) emit(REG_MOVE,line_number,address.slot,operand);
+        }
+        else if(address.global) emit(REG_SET_GLOBAL,line_number,address.slot,operand);
+        else emit(REG_SET_OUTER,line_number,address.hops,address.slot,operand);
+    }
+
+    uint32_t nil_register(int line_number) {
+
+        uint32_t nil = temporary();
+        emit(REG_NIL,line_number,nil);
+        return nil;
+    }
+
+    void open_scope(uint32_t size) {
+
+        layout.open_scope(size);
+        chunk().register_count = max(chunk().register_count,layout.next_slot);
+    }
+
+    void statement(ast::statement* stmt) {
+
+        next_temporary = layout.next_slot;
+        visit(stmt);
+    }
+
+    void statements(const pmr::vector<ast::statement*> &statements) {
+
+        for(auto stmt: statements) statement(stmt);
+    }
+
+    public:
+    register_compiler(register_program &program, const source_buffer &source): program(program), source(source), constants(program.constants) {}
+
+    void compile_top_level(const vector<ast::statement*> &top_level) {
+
+        program.functions.emplace_back();
+        function = 0;
+        uint32_t size = top_level_frame_size(top_level);
+        open_scope(size);
+        for(auto stmt: top_level) statement(stmt);
+        next_temporary = layout.next_slot;
+        emit(REG_RETURN,0,nil_register(0));
+        layout.close_scope(size);
+    }
+
+    uint32_t compile_function(function_declaration_statement* stmt) {
+
+        uint32_t outer_function = function, outer_next_temporary = next_temporary;
+        uint32_t outer_next_slot = layout.enter_function();
+        program.functions.emplace_back();
+        function = program.functions.size() - 1;
+        chunk().parameter_count = stmt->parameters.size();
+
+        open_scope(stmt->frame_size);
+        statement(stmt->block);
+        next_temporary = layout.next_slot;
+        emit(REG_RETURN,stmt->line_number,nil_register(stmt->line_number)); //falling off the end returns nil
+        layout.close_scope(stmt->frame_size);
+
+        uint32_t index = function;
+        layout.leave_function(outer_next_slot);
+        function = outer_function;
+        next_temporary = outer_next_temporary;
+        return index;
+    }
+
+    void visit_conditional_statement(conditional_statement* stmt) {
+
+        uint32_t to_else = condition(stmt->expr,false);
+        statement(stmt->if_statements);
+        if(stmt->else_statements == NULL) {
+
+            patch_jump(to_else);
+            return;
+        }
+
+        uint32_t to_end = emit(REG_JUMP,stmt->line_number);
+        patch_jump(to_else);
+        statement(stmt->else_statements);
+        patch_jump(to_end);
+    }
+
+    void visit_block_statement(block_statement* stmt) {
+
+        open_scope(stmt->frame_size);
+        statements(stmt->statements);
+        layout.close_scope(stmt->frame_size);
+    }
+
+    void visit_while_statement(while_statement* stmt) {
+        //the condition goes after the body, so an iteration takes one jump instead of two
+
+        uint32_t to_condition = emit(REG_JUMP,stmt->line_number);
+        uint32_t start = chunk().code.size();
+        statement(stmt->statements);
+        patch_jump(to_condition);
+        jump_to(condition(stmt->expr,true),start);
+    }
+
+    void visit_for_statement(for_statement* stmt) {
+        //the header and a block body share the loop's scope
+
+        open_scope(stmt->frame_size);
+        if(stmt->part1 != NULL) statement(stmt->part1);
+
+        uint32_t to_condition = stmt->part2 != NULL ? emit(REG_JUMP,stmt->line_number) : no_register;
+        uint32_t start = chunk().code.size();
+        if(stmt->statements->kind == BLOCK_NODE) statements(static_cast<block_statement*>(stmt->statements)->statements);
+        else statement(stmt->statements);
+        if(stmt->part3 != NULL) {
+
+            next_temporary = layout.next_slot;
+            compile_expression(stmt->part3);
+        }
+
+        if(stmt->part2 != NULL) {
+
+            patch_jump(to_condition);
+            jump_to(condition(stmt->part2,true),start);
+        }
+        else jump_to(emit(REG_JUMP,stmt->line_number),start);
+        layout.close_scope(stmt->frame_size);
+    }
+
+    void visit_expression_statement(expression_statement* stmt) {
+
+        compile_expression(stmt->exp);
+    }
+
+    void visit_declaration_statement(declaration_statement* stmt) {
+
+        uint32_t slot = layout.declared(stmt->slot);
+        if(stmt->exp != NULL) compile_expression(stmt->exp,slot);
+        else emit(REG_NIL,stmt->line_number,slot);
+    }
+
+    void visit_print_statement(print_statement* stmt) {
+
+        emit(REG_PRINT,stmt->line_number,compile_expression(stmt->exp));
+    }
+
+    void visit_input_statement(input_statement* stmt) {
+
+        slot_address address = layout.locate(stmt->binding);
+        uint32_t target = address.hops == 0 ? address.slot : temporary();
+        register_opcode op = stmt->input_type == STRING_TYPE ? REG_INPUT_STRING : REG_INPUT_NUMBER;
+        emit(op,stmt->line_number,target,constants.string(stmt->input_reciever_variable.lexeme(source)));
+        store(stmt->binding,target,stmt->line_number);
+    }
+
+    void visit_return_statement(return_statement* stmt) {
+
+        uint32_t result = stmt->return_exp != NULL ? compile_expression(stmt->return_exp) : nil_register(stmt->line_number);
+        emit(REG_RETURN,stmt->line_number,result);
+    }
+
+    void visit_function_declaration_statement(function_declaration_statement* stmt) {
+
+        uint32_t index = compile_function(stmt);
+        emit(REG_CLOSURE,stmt->line_number,layout.declared(stmt->slot),index);
+    }
+
+    void visit_class_declaration_statement(class_declaration_statement* stmt) {}
+
+    uint32_t visit_binary_expression(binary_expression* exp) {
+
+        if(exp->optr.type == EQUAL) {
+            //a local is assigned by computing straight into its register
+
+            frame_slot binding = static_cast<variable_literal_expression*>(exp->left)->binding;
+            slot_address address = layout.locate(binding);
+            if(address.hops == 0) return compile_expression(exp->right,address.slot);
+
+            uint32_t assigned = compile_expression(exp->right);
+            store(binding,assigned,exp->line_number);
+            return assigned;
+        }
+
+        uint32_t target = destination;
+        auto both = operands(exp->left,exp->right);
+        uint32_t result = target != no_register ? target : temporary();
+        emit(register_opcode(REG_ADD + operator_index(exp->optr.type)),exp->line_number,result,both.first,both.second);
+        return result;
+    }
+
+    uint32_t visit_logical_expression(logical_expression* exp) {
+        //the result is written before the right operand runs, so it can not be a variable the right operand reads
+
+        uint32_t result = destination != no_register && !is_variable(destination) ? destination : temporary();
+        compile_expression(exp->left,result);
+        uint32_t to_end = emit(exp->optr.type == OR ? REG_JUMP_IF_TRUE : REG_JUMP_IF_FALSE,exp->line_number,0,result);
+        compile_expression(exp->right,result);
+        patch_jump(to_end);
+        return result;
+    }
+
+    uint32_t visit_unary_expression(unary_expression* exp) {
+
+        uint32_t target = destination;
+        uint32_t operand = compile_expression(exp->right);
+        uint32_t result = target != no_register ? target : temporary();
+        emit(exp->optr.type == BANG ? REG_NOT : REG_NEGATE,exp->line_number,result,operand);
+        return result;
+    }
+
+    uint32_t visit_literal_expression(literal_expression* exp) {
+
+        switch(exp->literal.type) {
+
+            case NUMBER_TYPE: return constants.number(exp->literal.number_literal_value(source)) | constant_operand;
+            case STRING_TYPE: return constants.string(exp->literal.string_literal_value(source)) | constant_operand;
+            default: {
+
+                uint32_t result = result_register();
+                token_type literal = exp->literal.type;
+                emit(literal == TRUE ? REG_TRUE : literal == FALSE ? REG_FALSE : REG_NIL,exp->line_number,result);
+                return result;
+            }
+        }
+    }
+
+    uint32_t visit_variable_literal_expression(variable_literal_expression* exp) {
+
+        slot_address address = layout.locate(exp->binding);
+        if(address.hops == 0) return address.slot;
+
+        uint32_t result = result_register();
+        load(exp->binding,result,exp->line_number);
+        return result;
+    }
+
+    uint32_t visit_function_call_expression(function_call_expression* exp) {
+        //the arguments go into the registers right above the callee, where they become the callee's parameters
+
+        uint32_t callee = temporary();
+        load(exp->binding,callee,exp->line_number);
+        for(uint32_t i = 0; i<exp->arguments.size(); i++) {
+
+            next_temporary = callee + 1 + i;
+            compile_expression(exp->arguments[i],temporary());
+        }
+        next_temporary = callee + 1;
+        emit(REG_CALL,exp->line_number,callee,exp->arguments.size());
+        return callee;
+    }
+
+};
+
+register_program compile_registers(const vector<statement*> &program, const source_buffer &source) {
+
+    register_program compiled;
+    register_compiler compiler(compiled,source);
+    compiler.compile_top_level(program);
+    return compiled;
+}
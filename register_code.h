@@ -0,0 +1,92 @@
+//register_code.h
+#ifndef REGISTER_CODE_H
+#define REGISTER_CODE_H
+
+#include <cstdint>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "value.h"
+
+typedef enum : uint8_t {
+    /* three address instructions over the registers of a frame: the slots semantic_analyser resolved, then the
+     * temporaries of expressions. An operand marked "rk" is a register, or a constant when constant_operand is set in
+     * it. Jump offsets count from the next instruction */
+
+    REG_MOVE, //a = rk b
+    REG_NIL, //a = nil
+    REG_TRUE,
+    REG_FALSE,
+    REG_GET_GLOBAL, //a = slot b of the frame of the top level statements
+    REG_SET_GLOBAL, //slot a = rk b
+    REG_GET_OUTER, //a = slot c of the frame b hops out along the declaring frames
+    REG_SET_OUTER, //slot b of the frame a hops out = rk c
+    REG_ADD, //a = rk b + rk c
+    REG_SUBTRACT,
+    REG_MULTIPLY,
+    REG_DIVIDE,
+    REG_LESS,
+    REG_LESS_EQUAL,
+    REG_GREATER,
+    REG_GREATER_EQUAL,
+    REG_EQUAL,
+    REG_NOT_EQUAL,
+    REG_NEGATE, //a = -rk b
+    REG_NOT,
+    REG_JUMP, //offset a
+    REG_JUMP_IF_FALSE, //offset a when rk b is false
+    REG_JUMP_IF_TRUE,
+    REG_JUMP_IF_LESS, //offset a when rk b < rk c, the comparisons of loop and if conditions in one instruction
+    REG_JUMP_IF_LESS_EQUAL,
+    REG_JUMP_IF_GREATER,
+    REG_JUMP_IF_GREATER_EQUAL,
+    REG_JUMP_IF_EQUAL,
+    REG_JUMP_IF_NOT_EQUAL,
+    REG_JUMP_UNLESS_LESS, //offset a unless rk b < rk c
+    REG_JUMP_UNLESS_LESS_EQUAL,
+    REG_JUMP_UNLESS_GREATER,
+    REG_JUMP_UNLESS_GREATER_EQUAL,
+    REG_JUMP_UNLESS_EQUAL,
+    REG_JUMP_UNLESS_NOT_EQUAL,
+    REG_CLOSURE, //a = function b with the running frame as the one it was declared in
+    REG_CALL, //calls register a with the b arguments in the registers right above it, the result goes to a
+    REG_RETURN, //rk a
+    REG_PRINT, //rk a
+    REG_INPUT_NUMBER, //a = the next line, b is the constant holding the name of the receiving variable
+    REG_INPUT_STRING,
+    REG_COUNT
+
+} register_opcode;
+
+const uint32_t constant_operand = 1u << 31;
+
+class register_instruction {
+
+    public:
+    register_opcode op;
+    uint32_t a, b, c;
+
+};
+
+class register_function: public line_table {
+
+    public:
+    std::vector<register_instruction> code;
+    uint32_t parameter_count = 0;
+    uint32_t register_count = 0; //the frame the blocks are folded into and the temporaries above it
+
+};
+
+class register_program {
+
+    public:
+    std::vector<register_function> functions; //functions[0] runs the top level statements
+    std::vector<value> constants;
+
+};
+
+/* compiles an analysed program for the register machine. Variables are registers at the slots compile_program would
+ * give them, so i = i + 1 on a local is one REG_ADD where the stack machine needs four instructions */
+register_program compile_registers(const std::vector<ast::statement*> &program, const tok::source_buffer &source);
+
+#endif
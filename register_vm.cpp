@@ -0,0 +1,270 @@
+#include "register_vm.h"
+#include <algorithm>
+
+using namespace std;
+
+
+register_machine:: register_machine(const register_program &program, ostream &out, istream &in): program(program), out(out), in(in) {}
+
+void register_machine:: run(bool threaded, bool counting) {
+
+    const register_function &top_level = program.functions[0];
+    stack.assign(max<size_t>(top_level.register_count,1 << 12),value());
+    frames.assign(1,register_frame{&top_level,top_level.code.data(),0,UINT32_MAX});
+
+    dispatches = 0;
+    if(counting) execute<false,true>();
+    else if(threaded && threaded_dispatch_available) execute<true,false>();
+    else execute<false,false>();
+    out.flush();
+}
+
+string register_machine:: runtime_error(const register_instruction* instruction, const string &message) const {
+
+    const register_function &function = *frames.back().function;
+    int line_number = function.line_of(instruction - function.code.data());
+    return "RUNTIME ERROR at line " + to_string(line_number) + " : " + message;
+}
+
+value register_machine:: binary_fallback(register_opcode op, const value &left, const value &right, const register_instruction* instruction) const {
+
+    if(op == REG_EQUAL) return value(double(left.equals(right)));
+    if(op == REG_NOT_EQUAL) return value(double(!left.equals(right)));
+
+    if(left.kind() == STRING_VALUE && right.kind() == STRING_VALUE) {
+
+        if(op == REG_ADD) return concatenate(left,right);
+        const string &a = left.text(), &b = right.text();
+        switch(op) {
+
+            case REG_LESS: return value(double(a < b));
+            case REG_LESS_EQUAL: return value(double(a <= b));
+            case REG_GREATER: return value(double(a > b));
+            case REG_GREATER_EQUAL: return value(double(a >= b));
+            default: break;
+        }
+    }
+
+    const char* operators[] = {"+","-","*","/","<","<=",">",">="};
+    throw runtime_error(instruction,"Invalid operands " + string(left.kind_name()) + " and " + right.kind_name() + " to operator " + operators[op - REG_ADD]);
+}
+
+value register_machine:: read_input(const register_instruction* instruction) {
+
+    string line;
+    if(!getline(in,line)) throw runtime_error(instruction,"no input left for \"" + program.constants[instruction->b].text() + "\"");
+    if(instruction->op == REG_INPUT_STRING) return value(std::move(line));
+
+    double number;
+    if(!parse_number(line,number)) throw runtime_error(instruction,"\"" + line + "\" is not a number");
+    return value(number);
+}
+
+#if defined(__GNUC__) && defined(ALOX_SWITCH_DISPATCH)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-label" //the threaded labels, with no jump table to refer to them
+#endif
+template<bool threaded, bool counting>
+void register_machine:: execute() {
+    /* i is the running instruction and ip the one after it. The running frame's registers live in locals, which is
+     * reloaded whenever a call may have grown the stack */
+
+#if defined(__GNUC__) && !defined(ALOX_SWITCH_DISPATCH)
+    static void* const jump_table[REG_COUNT] = {
+        &&op_move, &&op_nil, &&op_true, &&op_false, &&op_get_global, &&op_set_global, &&op_get_outer, &&op_set_outer,
+        &&op_add, &&op_subtract, &&op_multiply, &&op_divide,
+        &&op_less, &&op_less_equal, &&op_greater, &&op_greater_equal, &&op_equal, &&op_not_equal,
+        &&op_negate, &&op_not, &&op_jump, &&op_jump_if_false, &&op_jump_if_true,
+        &&op_jump_if_less, &&op_jump_if_less_equal, &&op_jump_if_greater, &&op_jump_if_greater_equal, &&op_jump_if_equal, &&op_jump_if_not_equal,
+        &&op_jump_unless_less, &&op_jump_unless_less_equal, &&op_jump_unless_greater, &&op_jump_unless_greater_equal, &&op_jump_unless_equal, &&op_jump_unless_not_equal,
+        &&op_closure, &&op_call, &&op_return, &&op_print, &&op_input_number, &&op_input_string
+    };
+#define NEXT_THREADED i = ip++; goto *jump_table[i->op]
+#else
+#define NEXT_THREADED
+#endif
+#define DISPATCH() do { if constexpr (threaded) { NEXT_THREADED; } else { goto dispatch; } } while(0)
+#define RK(operand) (((operand) & constant_operand ? constants : locals)[(operand) & ~constant_operand])
+
+    register_frame* frame = &frames.back();
+    const register_instruction* ip = frame->ip;
+    const register_instruction* i;
+    const value* constants = program.constants.data();
+    value* globals = stack.data();
+    value* locals = globals + frame->base;
+
+    //the registers of the frame hops declaring frames out from the running one
+    auto outer_frame = [&](uint32_t hops) {
+
+        uint32_t index = frame->parent;
+        while(--hops > 0) index = frames[index].parent;
+        return stack.data() + frames[index].base;
+    };
+
+    if constexpr (threaded) { NEXT_THREADED; }
+
+    [[maybe_unused]] dispatch: //only the switch loop comes back here
+    if constexpr (counting) dispatches++;
+    i = ip++;
+    switch(i->op) {
+
+        case REG_MOVE: op_move:
+            locals[i->a] = RK(i->b);
+            DISPATCH();
+
+        case REG_NIL: op_nil:
+            locals[i->a] = value();
+            DISPATCH();
+
+        case REG_TRUE: op_true:
+            locals[i->a] = value(true);
+            DISPATCH();
+
+        case REG_FALSE: op_false:
+            locals[i->a] = value(false);
+            DISPATCH();
+
+        case REG_GET_GLOBAL: op_get_global:
+            locals[i->a] = globals[i->b];
+            DISPATCH();
+
+        case REG_SET_GLOBAL: op_set_global:
+            globals[i->a] = RK(i->b);
+            DISPATCH();
+
+        case REG_GET_OUTER: op_get_outer:
+            locals[i->a] = outer_frame(i->b)[i->c];
+            DISPATCH();
+
+        case REG_SET_OUTER: op_set_outer:
+            outer_frame(i->a)[i->b] = RK(i->c);
+            DISPATCH();
+
+#define NUMBER_OPERATION(op, label, result) \
+        case op: label: { \
+            const value &left = RK(i->b), &right = RK(i->c); \
+            if(left.is_number() && right.is_number()) locals[i->a] = value(double(result)); \
+            else locals[i->a] = binary_fallback(op,left,right,i); \
+            DISPATCH(); \
+        }
+
+        NUMBER_OPERATION(REG_ADD,op_add,left.number() + right.number())
+        NUMBER_OPERATION(REG_SUBTRACT,op_subtract,left.number() - right.number())
+        NUMBER_OPERATION(REG_MULTIPLY,op_multiply,left.number() * right.number())
+        NUMBER_OPERATION(REG_DIVIDE,op_divide,left.number() / right.number())
+        NUMBER_OPERATION(REG_LESS,op_less,left.number() < right.number())
+        NUMBER_OPERATION(REG_LESS_EQUAL,op_less_equal,left.number() <= right.number())
+        NUMBER_OPERATION(REG_GREATER,op_greater,left.number() > right.number())
+        NUMBER_OPERATION(REG_GREATER_EQUAL,op_greater_equal,left.number() >= right.number())
+        NUMBER_OPERATION(REG_EQUAL,op_equal,left.number() == right.number())
+        NUMBER_OPERATION(REG_NOT_EQUAL,op_not_equal,left.number() != right.number())
+#undef NUMBER_OPERATION
+
+        case REG_NEGATE: op_negate: {
+
+            const value &operand = RK(i->b);
+            if(!operand.is_number()) throw runtime_error(i,"Invalid operand " + string(operand.kind_name()) + " to operator -");
+            locals[i->a] = value(-operand.number());
+            DISPATCH();
+        }
+
+        case REG_NOT: op_not:
+            locals[i->a] = value(double(!RK(i->b).truthy()));
+            DISPATCH();
+
+        case REG_JUMP: op_jump:
+            ip += int32_t(i->a);
+            DISPATCH();
+
+        case REG_JUMP_IF_FALSE: op_jump_if_false:
+            if(!RK(i->b).truthy()) ip += int32_t(i->a);
+            DISPATCH();
+
+        case REG_JUMP_IF_TRUE: op_jump_if_true:
+            if(RK(i->b).truthy()) ip += int32_t(i->a);
+            DISPATCH();
+
+#define COMPARE_AND_JUMP(op, label, operation, compare, when) \
+        case op: label: { \
+            const value &left = RK(i->b), &right = RK(i->c); \
+            bool holds = left.is_number() && right.is_number() ? left.number() compare right.number() : binary_fallback(operation,left,right,i).truthy(); \
+            if(holds == when) ip += int32_t(i->a); \
+            DISPATCH(); \
+        }
+
+        COMPARE_AND_JUMP(REG_JUMP_IF_LESS,op_jump_if_less,REG_LESS,<,true)
+        COMPARE_AND_JUMP(REG_JUMP_IF_LESS_EQUAL,op_jump_if_less_equal,REG_LESS_EQUAL,<=,true)
+        COMPARE_AND_JUMP(REG_JUMP_IF_GREATER,op_jump_if_greater,REG_GREATER,>,true)
+        COMPARE_AND_JUMP(REG_JUMP_IF_GREATER_EQUAL,op_jump_if_greater_equal,REG_GREATER_EQUAL,>=,true)
+        COMPARE_AND_JUMP(REG_JUMP_IF_EQUAL,op_jump_if_equal,REG_EQUAL,==,true)
+        COMPARE_AND_JUMP(REG_JUMP_IF_NOT_EQUAL,op_jump_if_not_equal,REG_NOT_EQUAL,!=,true)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_LESS,op_jump_unless_less,REG_LESS,<,false)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_LESS_EQUAL,op_jump_unless_less_equal,REG_LESS_EQUAL,<=,false)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_GREATER,op_jump_unless_greater,REG_GREATER,>,false)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_GREATER_EQUAL,op_jump_unless_greater_equal,REG_GREATER_EQUAL,>=,false)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_EQUAL,op_jump_unless_equal,REG_EQUAL,==,false)
+        COMPARE_AND_JUMP(REG_JUMP_UNLESS_NOT_EQUAL,op_jump_unless_not_equal,REG_NOT_EQUAL,!=,false)
+#undef COMPARE_AND_JUMP
+
+        case REG_CLOSURE: op_closure:
+            //semantic_analyser does not let a function value be assigned, so it never outlives the running frame
+            locals[i->a] = value(callable{&program.functions[i->b],uint32_t(frames.size() - 1)});
+            DISPATCH();
+
+        case REG_CALL: op_call: {
+
+            const value &callee = locals[i->a];
+            if(callee.kind() != FUNCTION_VALUE) throw runtime_error(i,string(callee.kind_name()) + " is not a function");
+            auto function = static_cast<const register_function*>(callee.function().code);
+            uint32_t parent = callee.function().frame;
+            if(frames.size() > max_call_depth) throw runtime_error(i,"Stack overflow, calls nest deeper than " + to_string(max_call_depth));
+
+            //the arguments stay where they are and become the first registers of the callee
+            uint32_t base = locals - stack.data() + i->a + 1;
+            size_t needed = size_t(base) + function->register_count;
+            if(needed > stack.size()) {
+
+                stack.resize(max(needed,stack.size() * 2));
+                globals = stack.data();
+            }
+
+            frame->ip = ip;
+            frames.push_back(register_frame{function,function->code.data(),base,parent});
+            frame = &frames.back();
+            ip = frame->ip;
+            locals = stack.data() + base;
+            DISPATCH();
+        }
+
+        case REG_RETURN: op_return: {
+
+            value result = RK(i->a);
+            frames.pop_back();
+            if(frames.empty()) return;
+
+            frame = &frames.back();
+            ip = frame->ip;
+            locals = stack.data() + frame->base;
+            locals[ip[-1].a] = std::move(result); //into the callee register of the call
+            DISPATCH();
+        }
+
+        case REG_PRINT: op_print:
+            out<<RK(i->a)<<'\n';
+            DISPATCH();
+
+        case REG_INPUT_NUMBER: op_input_number:
+        case REG_INPUT_STRING: op_input_string:
+            locals[i->a] = read_input(i);
+            DISPATCH();
+
+        default: throw runtime_error(i,"unknown opcode");
+    }
+
+#undef NEXT_THREADED
+#undef DISPATCH
+#undef RK
+}
+#if defined(__GNUC__) && defined(ALOX_SWITCH_DISPATCH)
+#pragma GCC diagnostic pop
+#endif
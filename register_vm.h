@@ -0,0 +1,48 @@
+//register_vm.h
+#ifndef REGISTER_VM_H
+#define REGISTER_VM_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "register_code.h"
+#include "value.h"
+#include "vm.h"
+
+class register_frame {
+
+    public:
+    const register_function* function;
+    const register_instruction* ip; //where the function continues once its callee returns
+    uint32_t base; //index of register 0 of the frame on the value stack
+    uint32_t parent; //the frame the function was declared in, for REG_GET_OUTER
+
+};
+
+class register_machine {
+
+    /* runs a register_program on one value stack. A frame is its function's register_count registers; a call starts
+     * the callee's frame at the arguments the caller left above the callee register, and the result is written back
+     * into that register. Dispatch works like virtual_machine's, and so do run time errors */
+
+    const register_program &program;
+    std::ostream &out;
+    std::istream &in;
+    std::vector<value> stack;
+    std::vector<register_frame> frames;
+
+    template<bool threaded, bool counting> void execute();
+    std::string runtime_error(const register_instruction* instruction, const std::string &message) const;
+    value binary_fallback(register_opcode op, const value &left, const value &right, const register_instruction* instruction) const;
+    value read_input(const register_instruction* instruction);
+
+    public:
+    uint64_t dispatches = 0; //instructions the last counting run went through
+
+    register_machine(const register_program &program, std::ostream &out = std::cout, std::istream &in = std::cin);
+    void run(bool threaded = threaded_dispatch_available, bool counting = false); //counting runs on the switch
+
+};
+
+#endif
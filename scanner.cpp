@@ -1,261 +1,588 @@
 #include "scanner.h"
 #include "token.h"
+#include<array>
+#include<algorithm>
+#include<charconv>
+#include<cstdlib>
+#include<cstring>
 #include<iostream>
+#include<limits>
 #include<vector>
 
 using namespace scan;
 using namespace tok;
 using namespace std;
 
-scanner:: scanner(string &source){
-    this->source = source;
-    this->start = 0;
-    this->current = 0;
-    this->line_number = 1;
-    
-    //initialize the token_type_identifier 
 
-    token_type_identifier = {{"(", LEFT_PAREN},{",",COMMA},{")",RIGHT_PAREN},{"=",EQUAL},{"==",EQUAL_EQUAL},{"var",VAR},{";",SEMICOLON},{"+",PLUS},{"/",SLASH},{"-",MINUS},
-                             { "{", LEFT_BRACE},{"}",RIGHT_BRACE},{".",DOT},{"*",STAR},{"!",BANG},{"!=",BANG_EQUAL},{">",GREATER},{">=",GREATER_EQUAL},{"<",LESS},
-                             {"<=",LESS_EQUAL}, {"and",AND},{"class",CLASS},{"if",IF},{"nil",NIL},{"or",OR},{"print",PRINT},{"return",RETURN},{"super",SUPER},{"this",THIS},
-                             {"true",TRUE},{"while",WHILE},{"else",ELSE},{"false",FALSE},{"fun",FUN},{"for",FOR},{"String",TYPE},{"Number",TYPE},{"Void",VOID_TYPE},
-                             {":",COLON},{"input_number",INPUT_NUMBER}, {"input_string",INPUT_STRING}};
-    //hardcoded for now. Can be generalized later
-                                                                             
+static constexpr array<unsigned char,256> build_char_class_table() {
+
+    array<unsigned char,256> table{};
 
+    for(int i = 0; i<256; i++) table[i] = IDENTIFIER_CHAR;
+    for(int i = '0'; i<='9'; i++) table[i] = DIGIT_CHAR;
+
+    for(auto &spelling: token_spellings) {
+        //the first character of every single character spelling is an operator character (letters start keywords)
+
+        if(spelling.text.size() == 1) table[(unsigned char)spelling.text[0]] = OPERATOR_CHAR;
+    }
+
+    table[' '] = SPACE_CHAR;
+    table['\n'] = NEWLINE_CHAR;
+    table['"'] = QUOTE_CHAR;
+    table['\0'] = NULL_CHAR;
+
+    return table;
 }
 
+static constexpr array<unsigned char,256> build_operator_type_table() {
 
-void scanner:: ignore_comments(){
+    array<unsigned char,256> table{};
 
-        bool is_comment = check_comment_start(source);
-        while(is_comment && start < source.size()){
-            //to ignore the comments
+    for(auto &spelling: token_spellings) {
 
-            if(source[start] == '\n'){
-                
-                is_comment = false;
-                line_number++;
+        if(spelling.text.size() == 1) table[(unsigned char)spelling.text[0]] = spelling.type;
+    }
 
-            }
+    return table;
+}
 
-            start++;
+static constexpr bool is_word(string_view text) {
+
+    return (text[0] >= 'a' && text[0] <= 'z') || (text[0] >= 'A' && text[0] <= 'Z');
+}
+
+class two_character_operator {
+
+    public:
+    char second; //'\0' if no two character operator starts with this character
+    unsigned char type;
+
+};
 
+static constexpr array<two_character_operator,256> build_two_character_operator_table() {
+    //== != <= >=, indexed by their first character
+
+    array<two_character_operator,256> table{};
+
+    for(auto &spelling: token_spellings) {
+
+        if(spelling.text.size() == 2 && !is_word(spelling.text)) {
+
+            if(table[(unsigned char)spelling.text[0]].second != '\0') throw "two character operators sharing their first character need a wider table";
+            table[(unsigned char)spelling.text[0]] = {spelling.text[1],(unsigned char)spelling.type};
         }
+    }
+
+    return table;
 }
 
+/* keywords and type names are recognised through a perfect hash computed at compile time. The hash mixes the length
+ * with the first, second and last character; the multiplier is searched at compile time until no two words collide */
 
-void scanner:: ignore_white_spaces() {
+static constexpr size_t keyword_table_size = 64;
 
-        while((source[start] == ' ' || source[start] == '\n') && start <source.size()){
-            //to ignore the white space, end of line characters
+static constexpr size_t keyword_hash(string_view word, uint32_t multiplier) {
 
-            if(source[start] == '\n'){
-                line_number++;
-            }
-            
-            start++;
+    uint32_t key = (uint32_t)word.size() | (uint32_t)(unsigned char)word[0] << 8 | (uint32_t)(unsigned char)word[word.size() > 1] << 16 | (uint32_t)(unsigned char)word[word.size()-1] << 24;
+    return (key * multiplier) >> (32 - 6);
+}
+
+static constexpr uint32_t find_keyword_multiplier() {
+
+    for(uint32_t multiplier = 0x9E3779B1u; ; multiplier += 2) {
+
+        array<bool,keyword_table_size> used{};
+        bool collision = false;
+        for(auto &spelling: token_spellings) {
 
+            if(!is_word(spelling.text)) continue;
+            size_t slot = keyword_hash(spelling.text,multiplier);
+            if(used[slot]) {
+
+                collision = true;
+                break;
+            }
+            used[slot] = true;
         }
 
+        if(!collision) return multiplier;
+    }
+}
+
+static constexpr uint32_t keyword_multiplier = find_keyword_multiplier();
+
+static constexpr array<token_spelling,keyword_table_size> build_keyword_table() {
 
+    array<token_spelling,keyword_table_size> table{};
+    for(auto &slot: table) slot = {"",IDENTIFIER};
 
+    for(auto &spelling: token_spellings) {
+
+        if(is_word(spelling.text)) table[keyword_hash(spelling.text,keyword_multiplier)] = spelling;
+    }
+
+    return table;
 }
- 
-vector<token> scanner:: scan_source_code(){
+
+static constexpr auto char_class_table = build_char_class_table();
+static constexpr auto operator_type_table = build_operator_type_table();
+static constexpr auto two_character_operator_table = build_two_character_operator_table();
+static constexpr auto keyword_table = build_keyword_table();
+
+static inline char_class classify(char character) {
+
+    return (char_class) char_class_table[(unsigned char)character];
+}
+
+static inline bool continues_word(char character) {
+    //identifiers and number lexemes run until an operator, a white space or the end of the source
+
+    char_class cc = classify(character);
+    return cc == IDENTIFIER_CHAR || cc == DIGIT_CHAR || cc == QUOTE_CHAR;
+}
+
+static constexpr token_type lookup_keyword(string_view lexeme) {
+
+    const token_spelling &candidate = keyword_table[keyword_hash(lexeme,keyword_multiplier)];
+    return candidate.text == lexeme ? candidate.type : IDENTIFIER;
+}
+
+static_assert(lookup_keyword("input_string") == INPUT_STRING && lookup_keyword("Number") == TYPE && lookup_keyword("whilst") == IDENTIFIER, "keyword hash is broken");
+
+scanner:: scanner(source_buffer &source): source(source), identifiers(global_string_pool()), number_literals(source.number_literals) {
+    this->kernels = active_kernels();
+    this->start = 0;
+    this->current = 0;
+    this->limit = source.size();
+    this->line_number = 1;
 
 
-    while(start < source.size()){
 
-               
-        while(check_comment_start(source) || source[start] == ' ' || source[start] =='\n'){
-            
-            ignore_comments();
-            ignore_white_spaces();
-            
+
+}
+
+
+void scanner:: ignore_comments(){
+
+        if(!check_comment_start()) return;
+
+        //to ignore the comments, everything up to and including the end of line character
+        size_t end_of_line = kernels->find_newline(source.data(),start,limit);
+        if(end_of_line < limit) {
+
+            line_number++;
+            end_of_line++;
         }
-         
-        if(start == source.size()) break; //a situation where there are trailing white spaces till the end of file 
 
-        token current_token = generate_token();
-        tokens.push_back(current_token);
+        start = end_of_line;
+}
+
+
+void scanner:: ignore_white_spaces() {
+        //to ignore the white space, end of line characters
+
+        int newlines = 0;
+        start = kernels->skip_white_spaces(source.data(),start,limit,newlines);
+        line_number += newlines;
+
+}
+
+token scanner:: next_token(){
+    /* pull interface used by the parser: skips white spaces and comments and scans exactly one token.
+     * Once the source is exhausted every call returns the END_OF_FILE token */
+
+    while(start < limit && (check_comment_start() || classify(source[start]) == SPACE_CHAR || classify(source[start]) == NEWLINE_CHAR)){
+
+        ignore_comments();
+        ignore_white_spaces();
+
     }
 
-    //push EOF character
-    string eof = "\0";
-    token_type eof_type = END_OF_FILE;
-    tokens.push_back(token(eof,eof_type,line_number));
+    if(start == limit) return token(limit,0,END_OF_FILE,line_number); //a situation where there are trailing white spaces till the end of file
+
+    return generate_token();
+
+}
+
+vector<token> scanner:: scan_source_code(){
+    //materializes the whole token stream, for tools which need random access to it
+
+    vector<token> tokens;
+    do {
+
+        tokens.push_back(next_token());
+
+    } while(tokens.back().type != END_OF_FILE);
+
     return tokens;
 
 }
 
-bool scanner:: check_comment_start(string &source){
-    if(start+2>=source.size()){
+scanner:: scanner(source_buffer &source, size_t begin, size_t end, int first_line, string_pool &identifiers, vector<double> &number_literals):
+    source(source), identifiers(identifiers), number_literals(number_literals) {
+    //scans only [begin, end) of the source. Offsets in the tokens stay relative to the whole source buffer
+
+    this->kernels = active_kernels();
+    this->start = begin;
+    this->current = begin;
+    this->limit = end;
+    this->line_number = first_line;
+}
+
+uint32_t scanner:: add_number_literal(double value) {
+
+    number_literals.push_back(value);
+    return number_literals.size() - 1;
+}
+
+int scanner:: get_line_number(){
+
+    return line_number;
+}
+
+bool scanner:: check_comment_start(){
+    if(start+1>=limit){
         return false;
     }
-    
+
     else return source[start] == '/' && source[start+1] == '/';
 }
 
-pair<string,int> scanner:: get_lexeme(int start_index){
-        
-       int i = start_index;
-       string lexeme = "";
-   
-       if(source[start_index] == '"'){ //check if the lexeme is a string literal 
-
-           lexeme += source[i];
-           i++;
-
-           while( source[i] != '\0' && source[i] != '"' && source[i] != '\n'){
-               
-               lexeme += source[i];
-               i++;
-           }
-           if(source[i] == '\0' ||  source[i] == '\n'){
-               //throw exception of unterminated string
-               throw "ERROR: Unterminated string at line number "+ to_string(line_number) + "\n";
-            }
-           else
-           {
-               lexeme += source[i];      
-               return make_pair(lexeme,line_number);
-           }
+token scanner:: generate_token(){
+    /*token generation has the following steps:
+     * 1) classifying the first byte of the lexeme through the character class table
+     * 2) finding the end offset of the lexeme, the lexeme is cut out of the source exactly once
+     * 3) extracting the value
+     * 4) creating the token object, returning the token object
+     */
 
+        if(start > tok::max_token_offset) {
+            //the offset would not fit into the token. Nothing after it can be scanned, so scanning ends here
+            start = limit;
+            throw "ERROR: Source too large at line number "+ to_string(line_number) + ", tokens have to start in its first 4 GiB\n";
         }
 
-       else if(source[start_index]>=48 && source[start_index]<=57){
-
-                bool dot_spotted = false;
-                while((source[i] == '.' || (!is_single_character_lexeme((source[i])))  && source[i] != ' ' && source[i] != '\n' && source[i] != '\0')){
-                //i want to stop at all single character lexemes except the dot(.). Hence i take advantage of shortcircuiting, (if first condiiton is true, 
-                //2nd is never checked. if 1st is false, 2nd is false anyways.
-                    if(source[i] == '.'){
-                        if(dot_spotted){
+        switch(classify(source[start])) {
 
-                            break; //TODO: error handling at tokenizer phase or parsing phase
+        case QUOTE_CHAR:
+            return scan_string_literal();
+        case DIGIT_CHAR:
+            return scan_number_literal();
+        case OPERATOR_CHAR:
+            return scan_operator();
+        case NULL_CHAR:
+            start++;
+            throw "ERROR: Unexpected character at line number "+ to_string(line_number) + "\n";
+        default:
+            return scan_identifier();
+        }
 
-                        }
-                        else
-                        {
-                            dot_spotted = true;
-                        }
-                    }
-                    lexeme += source[i];
-                    i++;
+}
 
-                }
+token scanner:: scan_string_literal() {
 
-                return make_pair(lexeme,line_number);
-                 
-       }
-           
-       else if(is_single_character_lexeme(source[start_index])){ // check if we have a single character lexeme
-           //includes: ( ) { } , . ; \0 > < = *,+,- etc
-           if(is_two_character_operator(source.substr(start_index,2))){
-                lexeme += source.substr(start_index,2);
-           }
-           else
-           {
-                lexeme += source[start_index];
-           }
-
-           return make_pair(lexeme,line_number);
-       }
-       while(!is_single_character_lexeme(source[i]) && source[i]!= ' ' && source[i] != '\n' && source[i] != '\0'){ //check for other lexemes (keywords, identifiers)
-           
-                 lexeme += source[i];
-                 i++;
+        size_t end = kernels->find_string_end(source.data(),start+1,limit);
 
+        if(end == limit || classify(source[end]) != QUOTE_CHAR){
+            //throw exception of unterminated string. Scanning resumes at the end of the line
+            start = end;
+            throw "ERROR: Unterminated string at line number "+ to_string(line_number) + "\n";
         }
 
-        return make_pair(lexeme,line_number);
+        end++; //include the closing quote
+        check_lexeme_length(end);
+        token string_token(start,end-start,tok::STRING_TYPE,line_number);
+        start = end;
+
+        return string_token;
 }
-bool scanner:: is_two_character_operator(string optr){
-/* checks if the given string is ==, >=, <=, != .checks the token type table if the optr is present in table. Optr is guaranteed to start with a character which can be categorised as a single character lexeme */
-            bool is_tco = token_type_identifier.count(optr);
-            return is_tco;
+
+void scanner:: check_lexeme_length(size_t end) {
+    //a lexeme longer than token::length can hold is skipped and reported instead of being cut short
+
+    if(end - start > tok::max_lexeme_length) {
+        start = end;
+        throw "ERROR: Lexeme too long at line number "+ to_string(line_number) + "\n";
+    }
 }
-bool scanner:: is_single_character_lexeme(char character){
 
-    string strch = "";
-    strch += character;
+static inline int digit_value(char character) {
 
-    return token_type_identifier.count(strch); //the size of strch is one. the .count() will basically check if there is any token type which corresponds to strch. If there is not any, the single character lexeme  is not a single character token. 
+    if(character >= '0' && character <= '9') return character - '0';
+    if(character >= 'a' && character <= 'f') return character - 'a' + 10;
+    if(character >= 'A' && character <= 'F') return character - 'A' + 10;
+    return 16;
 }
-token_type scanner:: identify_token(string &lexeme){
 
-    token_type lexeme_type;
+size_t scanner:: scan_digits(size_t &end, int base, bool &separated) {
+    //digits of the given base. A _ is a separator only between two digits, anywhere else it ends the digits
 
-    if(token_type_identifier.count(lexeme)){
-        lexeme_type =  token_type_identifier[lexeme];
-    }
-    else if(is_string_literal(lexeme)){
-        lexeme_type = tok::STRING_TYPE;
-    }
-    else if(is_number_literal(lexeme)){
+    size_t count = 0;
+    while(end < limit) {
 
-        lexeme_type = tok::NUMBER_TYPE;
-    }
-    else
-    {
-        lexeme_type = IDENTIFIER;
+        if(digit_value(source[end]) < base) {
+
+            count++;
+            end++;
+        }
+        else if(source[end] == '_' && count > 0 && end+1 < limit && digit_value(source[end+1]) < base) {
+
+            separated = true;
+            end++;
+        }
+        else break;
     }
 
-    return lexeme_type;
+    return count;
 }
 
-bool scanner:: is_number_literal(string &lexeme){
+token scanner:: scan_number_literal() {
+    /* decimal literals with an optional fraction and exponent, 0x hexadecimal and 0b binary literals, all of them with
+     * optional _ separators. The extent is found in one pass and the value is parsed with from_chars, straight from
+     * the source or from a stack copy without the separators. from_chars is locale independent and correctly rounded */
+
+        const size_t max_literal_length = 256;
+        size_t end = start;
+        bool separated = false;
+        bool malformed = false;
+        int base = 10;
+
+        if(source[start] == '0' && start+1 < limit && (source[start+1] == 'x' || source[start+1] == 'X')) base = 16;
+        if(source[start] == '0' && start+1 < limit && (source[start+1] == 'b' || source[start+1] == 'B')) base = 2;
+        if(base != 10) end += 2;
+
+        size_t digits_begin = end;
+        malformed = scan_digits(end,base,separated) == 0;
+
+        if(base == 10) {
+
+            if(end < limit && source[end] == '.') {
+
+                end++; //a trailing dot is part of the literal: 1. is 1
+                scan_digits(end,10,separated);
+            }
+
+            if(end < limit && (source[end] == 'e' || source[end] == 'E')) {
 
-    for(int i = 0; i<lexeme.size(); i++){
-        
-        int dotcount = 0;
-        if((dotcount<=1 && lexeme[i] == '.') || lexeme[i]>=48 && lexeme[i]<=57){
-        
-            if(lexeme[i] == '.') dotcount++;
-            continue;
+                end++;
+                if(end < limit && (source[end] == '+' || source[end] == '-')) end++;
+                malformed = malformed || scan_digits(end,10,separated) == 0;
+            }
         }
-        else return false;
-    }
 
-    return true;
+        if(malformed || (end < limit && continues_word(source[end])) || end - digits_begin > max_literal_length) {
+
+            //skip the rest of the word so that scanning resumes after it
+            while(end < limit && (continues_word(source[end]) || source[end] == '.')) end++;
+            int literal_line = line_number;
+            start = end;
+            throw "ERROR: Malformed number literal at line number "+ to_string(literal_line) + "\n";
+        }
+
+        //the digits from_chars reads: the source itself, or one of the buffers below with the separators taken out
+        char digits[max_literal_length] = {};
+        char hex_digits[max_literal_length / 4 + 1] = {};
+        const char* first = source.data() + digits_begin;
+        size_t length = end - digits_begin;
+
+        if(separated || base == 2) {
+
+            size_t count = 0;
+            for(const char* digit = first; digit != first + length; digit++) {
+
+                if(*digit != '_') digits[count++] = *digit;
+            }
+
+            if(base == 2) {
+                //from_chars has no binary format, so the bits are regrouped into hexadecimal digits
+
+                size_t bits = count;
+                size_t hex_count = (bits + 3) / 4;
+                for(size_t i = 0; i<hex_count; i++) {
+
+                    int value = 0;
+                    for(int bit = 0; bit<4; bit++) {
+
+                        long position = (long)bits - (long)(hex_count - i) * 4 + bit;
+                        value = value * 2 + (position >= 0 && digits[position] == '1');
+                    }
+                    hex_digits[i] = "0123456789abcdef"[value];
+                }
+
+                first = hex_digits;
+                length = hex_count;
+            }
+            else {
+
+                first = digits;
+                length = count;
+            }
+        }
+
+        const char* last = first + length;
+        double literal_value = 0;
+        auto parsed = from_chars(first,last,literal_value,base == 10 ? chars_format::general : chars_format::hex);
+        if(parsed.ec == errc::result_out_of_range) {
+            //from_chars leaves the value alone. Give what strtod, and so input_number, gives: infinity above the range, 0 below it
+            literal_value = base != 10 ? numeric_limits<double>::infinity() : strtod(string(first,last).c_str(),NULL);
+        }
+
+        token number_token(start,end-start,tok::NUMBER_TYPE,line_number);
+        number_token.literal_index = add_number_literal(literal_value);
+        start = end;
+
+        return number_token;
 }
 
-bool scanner:: is_string_literal(string &lexeme){
+token scanner:: scan_operator() {
+        //== != <= >= are the only two character operators, everything else in the operator class is a single character lexeme
 
-       return lexeme[0] == '"' && lexeme[lexeme.size()-1] == '"';
+        token_type lexeme_type = (token_type) operator_type_table[(unsigned char)source[start]];
+        const two_character_operator &longer = two_character_operator_table[(unsigned char)source[start]];
+        size_t length = 1;
+
+        if(longer.second != '\0' && start+1 < limit && source[start+1] == longer.second) {
+
+            lexeme_type = (token_type) longer.type;
+            length = 2;
+        }
+
+        token operator_token(start,length,lexeme_type,line_number);
+        start += length;
+
+        return operator_token;
 }
 
+token scanner:: scan_identifier() {
+        //keywords, type names and identifiers
 
-token scanner:: generate_token(){
-    /*token generation has the following steps:
-     * 1) extracting the lexeme 
-     * 2) finding the appropriate classification type
-     * 3) extracting the value
-     * 4) creating the token object, returning the token object
-     */
-        auto lex_line = get_lexeme(start);
-        auto &lexeme = lex_line.first;
-        auto &line_number = lex_line.second;
+        size_t end = start;
+        while(end < limit && continues_word(source[end])) end++;
+        check_lexeme_length(end);
+
+        token identifier_token(start,end-start,IDENTIFIER,line_number);
+        start = end;
+
+        identifier_token.type = identify_token(identifier_token.lexeme(source));
+        if(identifier_token.type == IDENTIFIER) identifier_token.symbol_id = identifiers.intern(identifier_token.lexeme(source));
+        return identifier_token;
+}
+
+token_type scanner:: identify_token(string_view lexeme){
+
+    return lookup_keyword(lexeme);
+}
+
+token_buffer:: token_buffer(vector<token> tokens): tokens(std::move(tokens)), position(0) {}
+
+token token_buffer:: next_token() {
+
+    token next = tokens[position];
+    if(position + 1 < tokens.size()) position++;
+    return next;
+}
+
+int token_buffer:: get_line_number() {
+
+    return tokens[position].line_number;
+}
+
+class scanned_chunk {
+
+    public:
+    std::vector<token> tokens;
+    string_pool identifiers;
+    vector<double> number_literals;
+    bool failed = false;
+    string error;
 
-        token_type lexeme_type = identify_token(lexeme);
-        start += lexeme.size();
+};
 
-        if(lexeme_type == tok::STRING_TYPE){
+vector<token> scan:: scan_source_code_parallel(source_buffer &source, thread_pool &pool, size_t chunk_count) {
+    /* splits the source into chunks at line boundaries and scans them concurrently. No token or comment of the
+     * language spans a newline (string literals stop at one, comments end at one), so the scanner is in its initial
+     * state at the start of every line and a chunk can never begin inside a string literal or a comment.
+     * Every chunk interns into its own pool and keeps its own literal table. The chunks are stitched in source
+     * order, which rebases symbol ids and literal indices exactly as a sequential scan would have assigned them */
 
-            string literal_value = lexeme.substr(1,lexeme.size()-2); //need to test this
-            return token(lexeme,lexeme_type,line_number,literal_value);
+    const char* text = source.data();
+    size_t size = source.size();
+
+    vector<size_t> boundaries = {0};
+    for(size_t i = 1; i<chunk_count; i++) {
+
+        size_t target = max(size / chunk_count * i, boundaries.back());
+        const void* newline = target < size ? memchr(text + target,'\n',size - target) : NULL;
+        if(newline == NULL) break;
+
+        size_t boundary = (const char*)newline - text + 1;
+        if(boundary < size) boundaries.push_back(boundary);
+    }
+    boundaries.push_back(size);
+    size_t chunks = boundaries.size() - 1;
+
+    //line numbers of the chunk starts, so that tokens and error messages carry their final line numbers
+    vector<int> newline_counts(chunks);
+    pool.parallel_for(chunks,[&](size_t chunk) {
+
+        newline_counts[chunk] = count(text + boundaries[chunk],text + boundaries[chunk+1],'\n');
+    });
+
+    vector<int> first_lines(chunks);
+    int line = 1;
+    for(size_t chunk = 0; chunk<chunks; chunk++) {
+
+        first_lines[chunk] = line;
+        line += newline_counts[chunk];
+    }
+
+    vector<scanned_chunk> results(chunks);
+    pool.parallel_for(chunks,[&](size_t chunk) {
+
+        scanned_chunk &result = results[chunk];
+        scanner chunk_scanner(source,boundaries[chunk],boundaries[chunk+1],first_lines[chunk],result.identifiers,result.number_literals);
+
+        try {
+
+            for(token next = chunk_scanner.next_token(); next.type != END_OF_FILE; next = chunk_scanner.next_token()) {
+
+                result.tokens.push_back(next);
+            }
         }
-        else if(lexeme_type == tok::NUMBER_TYPE){
-            
-             double literal_value = stod(lexeme);
-             return token(lexeme,lexeme_type,line_number,literal_value);
+        catch(string error) {
 
+            result.failed = true;
+            result.error = error;
         }
-        else
-        {
-           return token(lexeme,lexeme_type,line_number); 
+    });
+
+    size_t token_count = 1;
+    for(auto &result: results) token_count += result.tokens.size();
+
+    vector<token> tokens;
+    tokens.reserve(token_count);
+    string_pool &identifiers = global_string_pool();
+
+    for(auto &result: results) {
+
+        vector<uint32_t> symbol_ids(result.identifiers.size());
+        for(uint32_t id = 0; id<symbol_ids.size(); id++) symbol_ids[id] = identifiers.intern(result.identifiers.lookup(id));
+
+        uint32_t literal_base = source.number_literals.size();
+        source.number_literals.insert(source.number_literals.end(),result.number_literals.begin(),result.number_literals.end());
+
+        for(token next: result.tokens) {
+
+            if(next.type == IDENTIFIER) next.symbol_id = symbol_ids[next.symbol_id];
+            else if(next.type == tok::NUMBER_TYPE) next.literal_index += literal_base;
+            tokens.push_back(next);
         }
 
+        //a sequential scan stops at the first error, so does the stitched one
+        if(result.failed) throw result.error;
+    }
 
+    tokens.push_back(token(size,0,END_OF_FILE,line));
+    return tokens;
 }
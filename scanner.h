@@ -4,38 +4,89 @@
 
 #include<string>
 #include<vector>
-#include<unordered_map>
+#include<string_view>
 #include "token.h"
+#include "simd_scan.h"
+#include "string_pool.h"
+#include "thread_pool.h"
 
 namespace scan {
-class scanner{
-    std:: string source;
-    std::vector<tok::token> tokens;
-    std::unordered_map<std::string,tok::token_type> token_type_identifier;
 
-    int start; //indicates the start position of the current lexeme
-    int current; //indicate the current position in the source code
+typedef enum {
+    /* classification of a single source byte. The scanner looks up every byte in a 256 entry table instead of
+     * building temporary strings and probing the token table */
+    IDENTIFIER_CHAR, //letters, underscores and every other byte which can continue an identifier
+    DIGIT_CHAR,
+    SPACE_CHAR,
+    NEWLINE_CHAR,
+    QUOTE_CHAR,
+    OPERATOR_CHAR, //( ) { } , . ; : = ! < > + - * /
+    NULL_CHAR
+
+} char_class;
+
+class token_stream {
+
+    /* what the parser pulls its tokens from: a scanner working on demand, or a buffer of tokens scanned ahead of time */
+
+    public:
+    virtual tok::token next_token() = 0;
+    virtual int get_line_number() = 0;
+    virtual ~token_stream() {}
+
+};
+
+class scanner: public token_stream {
+    tok::source_buffer &source;
+    tok::string_pool &identifiers; //every IDENTIFIER token carries the id its name was interned under
+    std::vector<double> &number_literals; //where NUMBER_TYPE tokens put their values, normally the source buffer's table
+    const scan_kernels* kernels; //vectorised loops for white spaces, comments and string literals
+
+    size_t start; //indicates the start position of the current lexeme
+    size_t current; //indicate the current position in the source code
+    size_t limit; //end of the scanned range, the end of the source unless a chunk of it is scanned
     int line_number; //indicates the current line in the source code
 
+    uint32_t add_number_literal(double value);
+    void check_lexeme_length(size_t end); //of the lexeme from start to end
+
     public:
-    scanner(std::string &source);
+    scanner(tok::source_buffer &source);
+    scanner(tok::source_buffer &source, size_t begin, size_t end, int first_line, tok::string_pool &identifiers, std::vector<double> &number_literals);
+    tok::token next_token();
     std::vector<tok::token> scan_source_code();
+    int get_line_number();
     tok::token generate_token();
-    std::string generate_lexeme(int start_index);
-    bool is_string_literal(std::string &lexeme);
-    bool is_number_literal(std::string &lexeme);
-    tok::token_type identify_token(std::string &lexeme);
-    bool is_single_character_lexeme(char character);
-    std::pair<std::string,int>  get_lexeme(int start_index);
-    bool check_comment_start(std::string &source);
+    tok::token scan_string_literal();
+    tok::token scan_number_literal();
+    size_t scan_digits(size_t &end, int base, bool &separated);
+    tok::token scan_operator();
+    tok::token scan_identifier();
+    tok::token_type identify_token(std::string_view lexeme);
+    bool check_comment_start();
     void ignore_comments();
     void ignore_white_spaces();
-    bool is_two_character_operator(std:: string optr);
-    
 
 
+
+};
+
+class token_buffer: public token_stream {
+
+    /* replays a token vector, e.g. the output of scan_source_code_parallel. The END_OF_FILE token is repeated forever */
+
+    std::vector<tok::token> tokens;
+    size_t position;
+
+    public:
+    token_buffer(std::vector<tok::token> tokens);
+    tok::token next_token();
+    int get_line_number();
+
 };
 
+std::vector<tok::token> scan_source_code_parallel(tok::source_buffer &source, thread_pool &pool, size_t chunk_count);
+
 
 }
 
@@ -1,8 +1,8 @@
 #include "ast.h"
-#include <any>
 #include "environment.h"
+#include "thread_pool.h"
 #include "token.h"
-#include <any>
+#include <algorithm>
 #include <string>
 #include <utility>
 
@@ -11,126 +11,220 @@ using namespace ast;
 using namespace tok;
 
 
-semantic_analyser:: semantic_analyser(vector<statement*> ast): ast(ast) {
+semantic_analyser:: semantic_analyser(vector<statement*> ast, const source_buffer &source): ast(ast), source(source) {
     this->symtab = new symbol_table();
+    this->return_encountered = false;
 };
 
+semantic_analyser:: ~semantic_analyser() {
+
+    delete this->symtab;
+}
+
 
 void semantic_analyser:: analyse_program() {
     this->symtab->start_scope();
     for(auto &stmt: ast) {
-        stmt->accept(this);
+        visit(stmt);
+    }
+    this->global_frame_size = this->symtab->scope_size();
+    this->symtab->end_scope();
+}
+
+
+void semantic_analyser:: analyse_program_parallel(thread_pool &pool, size_t chunk_count) {
+    /* phase one checks the top level statements in one pass but only declares the functions, which fixes every
+     * signature and global slot. A body sees the globals declared before it and nothing it declares is visible
+     * outside it, so in phase two chunks of consecutive bodies are checked concurrently, each by an analyser of its
+     * own that shares the global scope of this one. Diagnostics are put back in source order */
+
+    this->symtab->start_scope();
+    vector<size_t> error_starts; //where the diagnostics of each top level statement begin in error_stack
+    vector<function_declaration_statement*> functions;
+    vector<size_t> owners; //the top level statement of each function
+    vector<size_t> visible_globals; //globals declared up to and including each function
+
+    for(size_t i = 0; i<ast.size(); i++) {
+
+        error_starts.push_back(error_stack.size());
+        if(ast[i]->kind != FUNCTION_NODE) {
+
+            visit(ast[i]);
+            continue;
+        }
+
+        auto fd_stmt = static_cast<function_declaration_statement*>(ast[i]);
+        if(declare_function(fd_stmt)) {
+
+            functions.push_back(fd_stmt);
+            owners.push_back(i);
+            visible_globals.push_back(this->symtab->binding_count());
+        }
     }
+    error_starts.push_back(error_stack.size());
+    this->global_frame_size = this->symtab->scope_size();
+
+    size_t chunk_size = functions.size() / max(chunk_count,size_t(1)) + 1;
+    size_t chunks = (functions.size() + chunk_size - 1) / chunk_size;
+    vector<vector<string>> body_errors(functions.size());
+    pool.parallel_for(chunks,[&](size_t chunk) {
+
+        semantic_analyser worker({},source);
+        for(size_t f = chunk * chunk_size; f<min(functions.size(),(chunk + 1) * chunk_size); f++) {
+
+            worker.symtab->share_globals(*this->symtab,visible_globals[f]);
+            worker.check_function_body(functions[f]);
+            body_errors[f] = std::move(worker.error_stack);
+            worker.error_stack.clear();
+        }
+    });
     this->symtab->end_scope();
+
+    vector<string> merged;
+    size_t f = 0;
+    for(size_t i = 0; i<ast.size(); i++) {
+
+        merged.insert(merged.end(),error_stack.begin() + error_starts[i],error_stack.begin() + error_starts[i + 1]);
+        for(; f<functions.size() && owners[f] == i; f++) merged.insert(merged.end(),body_errors[f].begin(),body_errors[f].end());
+    }
+    error_stack = std::move(merged);
 }
 
+frame_slot semantic_analyser:: locate(token name) {
+
+    return frame_slot{this->symtab->depth_of(name),this->symtab->slot_of(name)};
+}
 
 void semantic_analyser :: visit_declaration_statement(declaration_statement *dec_stmt) {
     if(this->symtab->is_redeclaration(dec_stmt->variable_name)) {
-        string error = "ERROR at line " +to_string(dec_stmt->variable_name.line_number) + " : Redeclaration of identifier \"" + dec_stmt->variable_name.lexeme + "\"";
+        string error = "ERROR at line " +to_string(dec_stmt->variable_name.line_number) + " : Redeclaration of identifier \"" + string(dec_stmt->variable_name.lexeme(source)) + "\"";
         error_stack.push_back(error);
     }
     else
     {
         symbol_table_entry symb_entry{dec_stmt->variable_type};
+        dec_stmt->slot = this->symtab->scope_size();
         this->symtab->add_entry(dec_stmt->variable_name,symb_entry);
-        dec_stmt->exp->accept(this);
+        visit(dec_stmt->exp);
     }
 }
 void semantic_analyser:: visit_function_declaration_statement(function_declaration_statement* fd_stmt) {
+    if(declare_function(fd_stmt)) check_function_body(fd_stmt);
+}
+
+bool semantic_analyser:: declare_function(function_declaration_statement* fd_stmt) {
     if(this->symtab->is_redeclaration(fd_stmt->function_name)) {
-        string error = "ERROR at line " +to_string(fd_stmt->function_name.line_number) + " : Redeclaration of Function \"" + fd_stmt->function_name.lexeme + "\"";
+        string error = "ERROR at line " +to_string(fd_stmt->function_name.line_number) + " : Redeclaration of Function \"" + string(fd_stmt->function_name.lexeme(source)) + "\"";
         error_stack.push_back(error);
-
+        return false;
     }
-    else
-    {
-        symbol_table_entry symbtab_entry{FUNCTION_TYPE,fd_stmt->parameters,fd_stmt->return_type};
-        this->symtab->add_entry(fd_stmt->function_name,symbtab_entry);
-        this->symtab->start_scope(fd_stmt->function_name);
-        for(auto &parameter: fd_stmt->parameters) {
-            symbol_table_entry symb_entry{parameter.second};
-            this->symtab->add_entry(parameter.first, symb_entry);
-        }
 
-        fd_stmt->block->accept(this);
-        bool is_function_scope = true;
-        this->symtab->end_scope(is_function_scope);
-        if(symbtab_entry.return_type != VOID_TYPE && !this->return_encountered) {
-            string error = "ERROR at line " + to_string(fd_stmt->function_name.line_number) + ": Function \"" + fd_stmt->function_name.lexeme + "\" has non void return type but no return statement ";
-            error_stack.push_back(error);
-        }
-        this->return_encountered = false; //so that other functions can use it
+    symbol_table_entry symbtab_entry{FUNCTION_TYPE,{fd_stmt->parameters.begin(),fd_stmt->parameters.end()},fd_stmt->return_type};
+    fd_stmt->slot = this->symtab->scope_size();
+    this->symtab->add_entry(fd_stmt->function_name,symbtab_entry);
+    return true;
+}
+
+void semantic_analyser:: check_function_body(function_declaration_statement* fd_stmt) {
+    this->symtab->start_scope(fd_stmt->function_name);
+    for(auto &parameter: fd_stmt->parameters) {
+        symbol_table_entry symb_entry{parameter.second};
+        this->symtab->add_entry(parameter.first, symb_entry);
     }
 
+    fd_stmt->frame_size = this->symtab->scope_size();
+    enclosing_functions.push_back(fd_stmt);
+    visit(fd_stmt->block);
+    enclosing_functions.pop_back();
+    bool is_function_scope = true;
+    this->symtab->end_scope(is_function_scope);
+    if(fd_stmt->return_type != VOID_TYPE && !this->return_encountered) {
+        string error = "ERROR at line " + to_string(fd_stmt->function_name.line_number) + ": Function \"" + string(fd_stmt->function_name.lexeme(source)) + "\" has non void return type but no return statement ";
+        error_stack.push_back(error);
+    }
+    this->return_encountered = false; //so that other functions can use it
 }
 
 void semantic_analyser :: visit_for_statement(for_statement* for_stmt) {
     this->symtab->start_scope();
-    for_stmt->part1->accept(this);
-    for_stmt->part2->accept(this);
-    for_stmt->part3->accept(this);
-    if(typeid(*for_stmt->statements) == typeid(block_statement) ) {
+    if(for_stmt->part1 != NULL) visit(for_stmt->part1); //every part of the loop header is optional
+    if(for_stmt->part2 != NULL) visit(for_stmt->part2);
+    if(for_stmt->part3 != NULL) visit(for_stmt->part3);
+    if(for_stmt->statements->kind == BLOCK_NODE) {
         block_statement* block_stmt = static_cast<block_statement*>(for_stmt->statements);
         for(auto stmt: block_stmt->statements) {
-            stmt->accept(this);
+            visit(stmt);
         }
 
     }
+    else visit(for_stmt->statements); //a single statement body, which runs in the loop's frame as well
+    for_stmt->frame_size = this->symtab->scope_size();
     this->symtab->end_scope();
 
 }
 void semantic_analyser :: visit_expression_statement(expression_statement* exp_stmt) {
-    exp_stmt->exp->accept(this);
+    visit(exp_stmt->exp);
 }
 
 void semantic_analyser :: visit_print_statement(print_statement * print_stmt) {
-    print_stmt->exp->accept(this);
+    visit(print_stmt->exp);
 }
 
 void semantic_analyser :: visit_return_statement(return_statement* return_stmt) {
+    auto return_check = visit(return_stmt->return_exp);
+    if(enclosing_functions.empty()) {
+        //a top level return, which would leave the interpreter with no frame to return to
+        error_stack.push_back("ERROR at line " + to_string(return_stmt->line_number) + " : return outside a function");
+        return;
+    }
     return_encountered = true;
-    auto return_check = any_cast<pair<bool,token_type>>(return_stmt->return_exp->accept(this));
-    token current_function_name = this->symtab->get_current_function();
-    symbol_table_entry symtab_entry = this->symtab->get_entry(current_function_name); //get the current entry
-    token_type fnt_return_type = symtab_entry.return_type;
+    //the declaration itself rather than a lookup of its name, which a parameter or local of the same name would shadow
+    token current_function_name = enclosing_functions.back()->function_name;
+    token_type fnt_return_type = enclosing_functions.back()->return_type;
     if(fnt_return_type != return_check.second) {
-        string error = "ERROR at line " + to_string(current_function_name.line_number) + " : Function \"" + current_function_name.lexeme + "\" has incorrect return type";
+        string error = "ERROR at line " + to_string(current_function_name.line_number) + " : Function \"" + string(current_function_name.lexeme(source)) + "\" has incorrect return type";
         error_stack.push_back(error);
     }
 }
 void semantic_analyser :: visit_conditional_statement(conditional_statement* cond_stmt) {
 
-    cond_stmt->expr->accept(this);
-    cond_stmt->if_statements->accept(this);
+    visit(cond_stmt->expr);
+    visit(cond_stmt->if_statements);
     if(cond_stmt->else_statements != NULL) {
-        cond_stmt->else_statements->accept(this);
+        visit(cond_stmt->else_statements);
     }
 }
 
 void semantic_analyser :: visit_block_statement(block_statement* block_stmt) {
     this->symtab->start_scope();
     for(auto stmt: block_stmt->statements) {
-        stmt->accept(this);
+        visit(stmt);
     }
+    block_stmt->frame_size = this->symtab->scope_size();
     this->symtab->end_scope();
 }
 
 void semantic_analyser :: visit_input_statement(input_statement* inp_stmt) {
-    bool variable_resolved = this->symtab->resolve_identifier(inp_stmt->input_reciever_variable);
-    if(!variable_resolved) { //Part I: Resolve variable
-        string error = "ERROR at line " + to_string(inp_stmt->input_reciever_variable.line_number) + " : Unknown Variable \"" + inp_stmt->input_reciever_variable.lexeme + "\"";
+    const symbol_table_entry* inp_variable_entry = this->symtab->find_entry(inp_stmt->input_reciever_variable);
+    if(inp_variable_entry == NULL) { //Part I: Resolve variable
+        string error = "ERROR at line " + to_string(inp_stmt->input_reciever_variable.line_number) + " : Unknown Variable \"" + string(inp_stmt->input_reciever_variable.lexeme(source)) + "\"";
         error_stack.push_back(error);
     }
-    symbol_table_entry inp_variable_entry = this->symtab->get_entry(inp_stmt->input_reciever_variable);
-    if(inp_variable_entry.symbol_type != inp_stmt->input_type) {
-        string error = "ERROR at line " + to_string(inp_stmt->input_reciever_variable.line_number) + " : Type Mismatch:  Variable \"" + inp_stmt->input_reciever_variable.lexeme + "\"";
-        error_stack.push_back(error);
+    else {
+        inp_stmt->binding = locate(inp_stmt->input_reciever_variable);
+        if(inp_variable_entry->symbol_type != inp_stmt->input_type) {
+            string error = "ERROR at line " + to_string(inp_stmt->input_reciever_variable.line_number) + " : Type Mismatch:  Variable \"" + string(inp_stmt->input_reciever_variable.lexeme(source)) + "\"";
+            error_stack.push_back(error);
+        }
     }
 }
+void semantic_analyser :: visit_class_declaration_statement(class_declaration_statement* class_stmt) {
+    //classes are not analysed yet
+}
+
 void semantic_analyser :: visit_while_statement(while_statement* while_stmt) {
-    while_stmt->expr->accept(this);
-    while_stmt->statements->accept(this);
+    visit(while_stmt->expr);
+    visit(while_stmt->statements);
 }
 
 string get_token_type(token_type tt) {
@@ -140,51 +234,80 @@ string get_token_type(token_type tt) {
         return "String";
     case NUMBER_TYPE:
         return "Number";
+    default:
+        return "Unknown";
     }
 }
-any semantic_analyser :: visit_literal_expression(literal_expression* litexp) {
-    litexp->expression_type = litexp->literal.type;
-    auto return_obj = make_pair(true, litexp->literal.type);
+expression_check semantic_analyser :: visit_literal_expression(literal_expression* litexp) {
+    token_type literal_type = litexp->literal.type;
+    litexp->expression_type = literal_type;
+    auto return_obj = make_pair(true, literal_type);
     return return_obj;
 }
 
-any semantic_analyser :: visit_variable_literal_expression(variable_literal_expression* varexp) {
-    bool variable_resolved = symtab->resolve_identifier(varexp->variable_name); //Part I: Variable resolution
-    if(!variable_resolved) {
-        string error = "ERROR at line " + to_string(varexp->variable_name.line_number) + " : Unknown Variable \"" + varexp->variable_name.lexeme + "\"";
+expression_check semantic_analyser :: visit_variable_literal_expression(variable_literal_expression* varexp) {
+    const symbol_table_entry* symb_entry = symtab->find_entry(varexp->variable_name); //Part I: Variable resolution
+    if(symb_entry == NULL) {
+        string error = "ERROR at line " + to_string(varexp->variable_name.line_number) + " : Unknown Variable \"" + string(varexp->variable_name.lexeme(source)) + "\"";
         error_stack.push_back(error);
         return make_pair(false,ERROR);
     }
     else
     {
-        symbol_table_entry symb_entry = this->symtab->get_entry(varexp->variable_name); //Part II: Type infering
-        varexp->expression_type = symb_entry.symbol_type;
-        auto node_result = make_pair(true,symb_entry.symbol_type);
+        varexp->binding = locate(varexp->variable_name);
+        varexp->expression_type = symb_entry->symbol_type; //Part II: Type infering
+        auto node_result = make_pair(true,symb_entry->symbol_type);
         return node_result;
     }
 }
 
-any semantic_analyser :: visit_binary_expression(binary_expression* binexp) {
-    auto left_result = any_cast<pair<bool,token_type>>(binexp->left->accept(this));
-    auto right_result = any_cast<pair<bool,token_type>>(binexp->right->accept(this));
-    if(left_result.second == right_result.second && left_result.second != ERROR) {
-        binexp->expression_type = left_result.second;
-        return make_pair(true,left_result.second);
-    }
-    else if(left_result.second != ERROR && right_result.second!= ERROR) //implies left is of some other type and right is of some other type
-    {
+expression_check semantic_analyser :: visit_binary_expression(binary_expression* binexp) {
+    return check_operator_chain(binexp);
+}
 
-        string error = "ERROR at line " + to_string(binexp->line_number) + ": Invalid operand of type " + get_token_type(left_result.second) + " and " + get_token_type(right_result.second) + " to operator " + binexp->optr.lexeme;
-        error_stack.push_back(error);
+expression_check semantic_analyser :: visit_logical_expression(logical_expression* binexp) {
+    return check_operator_chain(binexp);
+}
 
+expression_check semantic_analyser :: visit_unary_expression(unary_expression* unexp) {
+    return check_operator_chain(unexp);
+}
 
+expression_check semantic_analyser :: check_operator_chain(expression* exp) {
+    /* a + b + c + ... nests down the left operands and - - x down the right one. Machine generated chains run a million
+     * operators long, so the chain is followed on operator_chain, an explicit stack on the heap, and folded back up in
+     * the order the recursive visits would have taken. Operands off the chain are visited normally */
+    size_t base = operator_chain.size();
+    while(exp->kind == BINARY_NODE || exp->kind == LOGICAL_NODE || exp->kind == UNARY_NODE) {
+        operator_chain.push_back(exp);
+        exp = exp->kind == UNARY_NODE ? static_cast<unary_expression*>(exp)->right : static_cast<binary_expression*>(exp)->left;
     }
-    return make_pair(false,ERROR);
+
+    expression_check result = visit(exp);
+    while(operator_chain.size() > base) {
+        expression* link = operator_chain.back();
+        operator_chain.pop_back();
+        if(link->kind == UNARY_NODE) {
+            link->expression_type = result.second;
+        }
+        else
+        {
+            binary_expression* binexp = static_cast<binary_expression*>(link);
+            result = check_operands(binexp,result,visit(binexp->right));
+        }
+    }
+    return result;
 }
 
-any semantic_analyser :: visit_logical_expression(logical_expression* binexp) {
-    auto left_result = any_cast<pair<bool,token_type>>(binexp->left->accept(this));
-    auto right_result = any_cast<pair<bool,token_type>>(binexp->right->accept(this));
+expression_check semantic_analyser :: check_operands(binary_expression* binexp, expression_check left_result, expression_check right_result) {
+    if(binexp->optr.type == EQUAL && left_result.second == FUNCTION_TYPE) {
+        /* a function value refers to the frame it was declared in, which the engines only keep while that frame runs.
+         * Assigning one would let a nested function outlive its frame, so function names are never reassigned */
+        auto function_name = static_cast<variable_literal_expression*>(binexp->left)->variable_name;
+        string error = "ERROR at line " + to_string(binexp->line_number) + " : Cannot assign to Function \"" + string(function_name.lexeme(source)) + "\"";
+        error_stack.push_back(error);
+        return make_pair(false,ERROR);
+    }
     if(left_result.second == right_result.second && left_result.second != ERROR) {
         binexp->expression_type = left_result.second;
         return make_pair(true,left_result.second);
@@ -192,42 +315,36 @@ any semantic_analyser :: visit_logical_expression(logical_expression* binexp) {
     else if(left_result.second != ERROR && right_result.second!= ERROR) //implies left is of some other type and right is of some other type
     {
 
-        string error = "ERROR at line " + to_string(binexp->line_number) + ": Invalid operand of type " + get_token_type(left_result.second) + " and " + get_token_type(right_result.second) + " to operator " + binexp->optr.lexeme;
+        string error = "ERROR at line " + to_string(binexp->line_number) + ": Invalid operand of type " + get_token_type(left_result.second) + " and " + get_token_type(right_result.second) + " to operator " + string(binexp->optr.lexeme(source));
         error_stack.push_back(error);
 
 
     }
     return make_pair(false,ERROR);
 }
-
-any semantic_analyser :: visit_unary_expression(unary_expression* unexp) {
-    auto right_result = any_cast<pair<bool,token_type>>(unexp->right->accept(this));
-    unexp->expression_type = right_result.second;
-    return right_result;
-}
-any semantic_analyser:: visit_function_call_expression(function_call_expression * fun_exp) {
-    bool function_name_resolved = symtab->resolve_identifier(fun_exp->function_name);
-    if(!function_name_resolved) {
-        string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + fun_exp->function_name.lexeme + "\"";
+expression_check semantic_analyser:: visit_function_call_expression(function_call_expression * fun_exp) {
+    const symbol_table_entry* symtab_entry = symtab->find_entry(fun_exp->function_name);
+    if(symtab_entry == NULL) {
+        string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + string(fun_exp->function_name.lexeme(source)) + "\"";
         error_stack.push_back(error);
         return make_pair(false,ERROR);
     }
     else
     {
-        symbol_table_entry symtab_entry = this->symtab->get_entry(fun_exp->function_name);//will return the arg_count
-        vector<pair<token,token_type>> parameters = symtab_entry.parameters;
-        token_type function_return_type = symtab_entry.return_type;
+        fun_exp->binding = locate(fun_exp->function_name);
+        auto &parameters = symtab_entry->parameters; //the entry is not copied, arguments cannot declare anything
+        token_type function_return_type = symtab_entry->return_type;
         bool final_result = true;
         if(parameters.size() != fun_exp->arguments.size()) {
-            string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + fun_exp->function_name.lexeme + "\" expects " + to_string(parameters.size()) + " arguments, " + to_string(fun_exp->arguments.size()) + " given";
+            string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + string(fun_exp->function_name.lexeme(source)) + "\" expects " + to_string(parameters.size()) + " arguments, " + to_string(fun_exp->arguments.size()) + " given";
             error_stack.push_back(error);
             final_result = false;
         }
 
-        for(int i = 0; i<fun_exp->arguments.size(); i++) {
-            auto exp_result = any_cast<pair<bool,token_type>>(fun_exp->arguments[i]->accept(this));
-            if(exp_result.second != parameters[i].second) {
-                string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + fun_exp->function_name.lexeme + "\" Type Mismatch: Parameter \"" + parameters[i].first.lexeme + "\" expects " + get_token_type(parameters[i].second)+ ", " + get_token_type(exp_result.second)+ " given ";
+        for(size_t i = 0; i<fun_exp->arguments.size(); i++) {
+            auto exp_result = visit(fun_exp->arguments[i]);
+            if(i < parameters.size() && exp_result.second != parameters[i].second) { //surplus arguments were reported above
+                string error = "ERROR at line " + to_string(fun_exp->function_name.line_number) + " : Function \"" + string(fun_exp->function_name.lexeme(source)) + "\" Type Mismatch: Parameter \"" + string(parameters[i].first.lexeme(source)) + "\" expects " + get_token_type(parameters[i].second)+ ", " + get_token_type(exp_result.second)+ " given ";
                 error_stack.push_back(error);
                 final_result = false;
             }
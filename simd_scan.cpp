@@ -0,0 +1,220 @@
+#include "simd_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ALOX_X86_KERNELS
+#endif
+
+using namespace scan;
+
+
+static size_t scalar_find_newline(const char* text, size_t begin, size_t end) {
+
+    while(begin < end && text[begin] != '\n') begin++;
+    return begin;
+}
+
+static size_t scalar_find_string_end(const char* text, size_t begin, size_t end) {
+
+    while(begin < end && text[begin] != '"' && text[begin] != '\n' && text[begin] != '\0') begin++;
+    return begin;
+}
+
+static size_t scalar_skip_white_spaces(const char* text, size_t begin, size_t end, int &newlines) {
+
+    while(begin < end && (text[begin] == ' ' || text[begin] == '\n')) {
+
+        if(text[begin] == '\n') newlines++;
+        begin++;
+    }
+
+    return begin;
+}
+
+static size_t scalar_skip_short_run(const char* text, size_t begin, size_t end, int &newlines, bool &finished) {
+    /* most blank runs between tokens are a single space. The vector kernels look at the first few bytes one at a time
+     * so that these runs do not pay for a vector load */
+
+    size_t head = begin + 8 < end ? begin + 8 : end;
+    while(begin < head && (text[begin] == ' ' || text[begin] == '\n')) {
+
+        if(text[begin] == '\n') newlines++;
+        begin++;
+    }
+
+    finished = begin < head || begin == end;
+    return begin;
+}
+
+static const scan_kernels scalar = {"scalar",scalar_find_newline,scalar_find_string_end,scalar_skip_white_spaces};
+
+
+#ifdef ALOX_X86_KERNELS
+
+/* SSE2 is part of x86-64, so these kernels need no target attribute. Each step compares 16 bytes against the
+ * interesting characters and turns the result into a bit mask, the scalar loops finish the last partial block */
+
+static size_t sse2_find_newline(const char* text, size_t begin, size_t end) {
+
+    const __m128i newline = _mm_set1_epi8('\n');
+    for(; begin + 16 <= end; begin += 16) {
+
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + begin));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block,newline));
+        if(mask != 0) return begin + __builtin_ctz(mask);
+    }
+
+    return scalar_find_newline(text,begin,end);
+}
+
+static size_t sse2_find_string_end(const char* text, size_t begin, size_t end) {
+
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i null = _mm_setzero_si128();
+    for(; begin + 16 <= end; begin += 16) {
+
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + begin));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block,quote),_mm_cmpeq_epi8(block,newline)),_mm_cmpeq_epi8(block,null));
+        unsigned mask = _mm_movemask_epi8(hits);
+        if(mask != 0) return begin + __builtin_ctz(mask);
+    }
+
+    return scalar_find_string_end(text,begin,end);
+}
+
+static size_t sse2_skip_white_spaces(const char* text, size_t begin, size_t end, int &newlines) {
+
+    bool finished;
+    begin = scalar_skip_short_run(text,begin,end,newlines,finished);
+    if(finished) return begin;
+
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for(; begin + 16 <= end; begin += 16) {
+
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + begin));
+        unsigned newline_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block,newline));
+        unsigned blank_mask = newline_mask | _mm_movemask_epi8(_mm_cmpeq_epi8(block,space));
+        unsigned other_mask = ~blank_mask & 0xffff;
+
+        if(other_mask != 0) {
+
+            unsigned position = __builtin_ctz(other_mask);
+            newlines += __builtin_popcount(newline_mask & ((1u << position) - 1));
+            return begin + position;
+        }
+
+        newlines += __builtin_popcount(newline_mask);
+    }
+
+    return scalar_skip_white_spaces(text,begin,end,newlines);
+}
+
+__attribute__((target("avx2,popcnt,bmi")))
+static size_t avx2_find_newline(const char* text, size_t begin, size_t end) {
+
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for(; begin + 32 <= end; begin += 32) {
+
+        __m256i block = _mm256_loadu_si256((const __m256i*)(text + begin));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block,newline));
+        if(mask != 0) return begin + __builtin_ctz(mask);
+    }
+
+    return sse2_find_newline(text,begin,end);
+}
+
+__attribute__((target("avx2,popcnt,bmi")))
+static size_t avx2_find_string_end(const char* text, size_t begin, size_t end) {
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i null = _mm256_setzero_si256();
+    for(; begin + 32 <= end; begin += 32) {
+
+        __m256i block = _mm256_loadu_si256((const __m256i*)(text + begin));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block,quote),_mm256_cmpeq_epi8(block,newline)),_mm256_cmpeq_epi8(block,null));
+        unsigned mask = _mm256_movemask_epi8(hits);
+        if(mask != 0) return begin + __builtin_ctz(mask);
+    }
+
+    return sse2_find_string_end(text,begin,end);
+}
+
+__attribute__((target("avx2,popcnt,bmi")))
+static size_t avx2_skip_white_spaces(const char* text, size_t begin, size_t end, int &newlines) {
+
+    bool finished;
+    begin = scalar_skip_short_run(text,begin,end,newlines,finished);
+    if(finished) return begin;
+
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for(; begin + 32 <= end; begin += 32) {
+
+        __m256i block = _mm256_loadu_si256((const __m256i*)(text + begin));
+        unsigned newline_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block,newline));
+        unsigned blank_mask = newline_mask | (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block,space));
+        unsigned other_mask = ~blank_mask;
+
+        if(other_mask != 0) {
+
+            unsigned position = __builtin_ctz(other_mask);
+            newlines += __builtin_popcount(newline_mask & (unsigned)((1ull << position) - 1));
+            return begin + position;
+        }
+
+        newlines += __builtin_popcount(newline_mask);
+    }
+
+    return sse2_skip_white_spaces(text,begin,end,newlines);
+}
+
+static const scan_kernels sse2 = {"sse2",sse2_find_newline,sse2_find_string_end,sse2_skip_white_spaces};
+static const scan_kernels avx2 = {"avx2",avx2_find_newline,avx2_find_string_end,avx2_skip_white_spaces};
+
+#endif
+
+
+const scan_kernels* scan:: scalar_kernels() {
+
+    return &scalar;
+}
+
+const scan_kernels* scan:: sse2_kernels() {
+
+#ifdef ALOX_X86_KERNELS
+    return &sse2;
+#else
+    return NULL;
+#endif
+}
+
+const scan_kernels* scan:: avx2_kernels() {
+
+#ifdef ALOX_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return &avx2;
+#endif
+    return NULL;
+}
+
+static const scan_kernels* select_kernels() {
+
+    if(avx2_kernels() != NULL) return avx2_kernels();
+    if(sse2_kernels() != NULL) return sse2_kernels();
+    return scalar_kernels();
+}
+
+static const scan_kernels* selected_kernels = select_kernels();
+
+const scan_kernels* scan:: active_kernels() {
+
+    return selected_kernels;
+}
+
+void scan:: use_kernels(const scan_kernels* kernels) {
+
+    selected_kernels = kernels;
+}
@@ -0,0 +1,31 @@
+//simd_scan.h
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include<cstddef>
+
+namespace scan {
+
+class scan_kernels {
+
+    /* byte search loops of the scanner. Every implementation returns exactly what the scalar one does,
+     * the vector ones only look at 16 or 32 bytes per step. All of them stop at end and never read past it */
+
+    public:
+    const char* name;
+    size_t (*find_newline)(const char* text, size_t begin, size_t end); //first '\n' at or after begin, end if none
+    size_t (*find_string_end)(const char* text, size_t begin, size_t end); //first '"', '\n' or '\0', end if none
+    size_t (*skip_white_spaces)(const char* text, size_t begin, size_t end, int &newlines); //first byte which is not ' ' or '\n', counts the newlines skipped
+
+};
+
+const scan_kernels* scalar_kernels();
+const scan_kernels* sse2_kernels(); //NULL when the build target has no SSE2
+const scan_kernels* avx2_kernels(); //NULL when the CPU has no AVX2
+
+const scan_kernels* active_kernels(); //the widest kernels the CPU supports, chosen once through CPUID
+void use_kernels(const scan_kernels* kernels); //benchmarks force a particular implementation with this
+
+}
+
+#endif
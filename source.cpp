@@ -0,0 +1,81 @@
+#include "source.h"
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tok;
+using namespace std;
+
+
+source_buffer:: source_buffer(string text): storage(std::move(text)), mapping(NULL) {
+
+    this->text = storage.data();
+    this->length = storage.size();
+}
+
+source_buffer:: source_buffer(int file_descriptor): text(NULL), length(0), mapping(NULL) {
+    /* regular files are mapped read only and scanned in place. Anything that cannot be mapped (pipes, terminals, empty files)
+     * is streamed into the storage string in large blocks */
+
+    struct stat file_status;
+    if(fstat(file_descriptor,&file_status) == 0 && S_ISREG(file_status.st_mode) && file_status.st_size > 0) {
+
+        void* address = mmap(NULL,file_status.st_size,PROT_READ,MAP_PRIVATE,file_descriptor,0);
+        if(address != MAP_FAILED) {
+
+            madvise(address,file_status.st_size,MADV_SEQUENTIAL);
+            this->mapping = address;
+            this->text = static_cast<const char*>(address);
+            this->length = file_status.st_size;
+            return;
+        }
+    }
+
+    const size_t block_size = 1 << 16;
+    size_t used = 0;
+    while(true) {
+
+        storage.resize(used + block_size);
+        ssize_t count = read(file_descriptor,&storage[used],block_size);
+        if(count < 0 && errno == EINTR) count = 0;
+        else if(count < 0) throw string("ERROR: could not read the source file");
+        else if(count == 0) break;
+        used += count;
+    }
+
+    storage.resize(used);
+    this->text = storage.data();
+    this->length = storage.size();
+}
+
+source_buffer:: ~source_buffer() {
+
+    if(this->mapping != NULL) munmap(this->mapping,this->length);
+}
+
+bool source_buffer:: is_mapped() const {
+
+    return this->mapping != NULL;
+}
+
+void source_buffer:: replace(size_t offset, size_t removed, string_view inserted) {
+    //applies an editor change. A mapped file is copied into the storage string first, it is never written through
+
+    if(this->mapping != NULL) {
+
+        storage.assign(this->text,this->length);
+        munmap(this->mapping,this->length);
+        this->mapping = NULL;
+    }
+
+    storage.replace(offset,removed,inserted);
+    this->text = storage.data();
+    this->length = storage.size();
+}
+
+uint32_t source_buffer:: add_number_literal(double value) {
+
+    this->number_literals.push_back(value);
+    return this->number_literals.size() - 1;
+}
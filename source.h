@@ -0,0 +1,45 @@
+//source.h
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include<string>
+#include<cstdint>
+#include<string_view>
+#include<vector>
+
+namespace tok {
+
+class source_buffer {
+
+    /* owns the text of a compilation unit. Tokens only store an offset and a length into this buffer,
+     * so it has to outlive every token, AST node and symbol table which refers to it.
+     * The text is either a read only mapping of the source file or, for pipes and stdin, a string it was streamed into */
+
+    const char* text;
+    size_t length;
+    std::string storage; //backs the text when it is not mapped
+    void* mapping;
+
+    public:
+    std::vector<double> number_literals; //literal side table, indexed by token::literal_index
+
+    source_buffer(std::string text);
+    source_buffer(int file_descriptor);
+    source_buffer(const source_buffer &) = delete;
+    source_buffer& operator=(const source_buffer &) = delete;
+    ~source_buffer();
+    bool is_mapped() const;
+    void replace(size_t offset, size_t removed, std::string_view inserted);
+    uint32_t add_number_literal(double value);
+
+    //the scanner calls these for every byte, so they are defined here to be inlined
+    const char* data() const { return text; }
+    size_t size() const { return length; }
+    char operator[](size_t index) const { return text[index]; }
+    std::string_view view(size_t offset, size_t length) const { return std::string_view(text + offset, length); }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "string_pool.h"
+#include <cstring>
+
+using namespace tok;
+using namespace std;
+
+
+static const size_t string_pool_block_size = 1 << 16;
+
+string_pool:: string_pool(): block_used(0), block_size(0) {}
+
+string_view string_pool:: store(string_view text) {
+    //names are packed into large blocks, a block is never reallocated so the views handed out stay valid
+
+    if(block_used + text.size() > block_size) {
+
+        block_size = max(string_pool_block_size,text.size());
+        blocks.push_back(unique_ptr<char[]>(new char[block_size]));
+        block_used = 0;
+    }
+
+    char* destination = blocks.back().get() + block_used;
+    memcpy(destination,text.data(),text.size());
+    block_used += text.size();
+    return string_view(destination,text.size());
+}
+
+uint32_t string_pool:: intern(string_view text) {
+
+    auto entry = ids.find(text);
+    if(entry != ids.end()) return entry->second;
+
+    string_view stored = store(text);
+    uint32_t id = strings.size();
+    strings.push_back(stored);
+    ids.emplace(stored,id);
+    return id;
+}
+
+string_view string_pool:: lookup(uint32_t id) const {
+
+    return strings[id];
+}
+
+size_t string_pool:: size() const {
+
+    return strings.size();
+}
+
+string_pool& tok:: global_string_pool() {
+
+    static string_pool pool;
+    return pool;
+}
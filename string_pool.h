@@ -0,0 +1,41 @@
+//string_pool.h
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include<cstdint>
+#include<memory>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
+
+namespace tok {
+
+class string_pool {
+
+    /* interns identifiers. Every distinct name is copied once into the pool's own storage and gets a dense 32 bit id,
+     * so later phases compare and index names by id instead of by string. Ids stay valid for the life of the pool,
+     * independently of the source buffer the name was scanned from */
+
+    std::vector<std::string_view> strings; //id -> name
+    std::unordered_map<std::string_view,uint32_t> ids; //name -> id, the keys view the pool's storage
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used;
+    size_t block_size;
+
+    std::string_view store(std::string_view text);
+
+    public:
+    string_pool();
+    string_pool(const string_pool &) = delete;
+    string_pool& operator=(const string_pool &) = delete;
+    uint32_t intern(std::string_view text);
+    std::string_view lookup(uint32_t id) const;
+    size_t size() const;
+
+};
+
+string_pool& global_string_pool(); //the pool the scanner interns into unless it is given another one
+
+}
+
+#endif
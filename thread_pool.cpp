@@ -0,0 +1,94 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+
+thread_pool:: thread_pool(size_t thread_count): task(NULL), task_count(0), next_index(0), finished_count(0), generation(0), stopping(false) {
+
+    //the caller of parallel_for is one of the threads
+    for(size_t i = 1; i<thread_count; i++) {
+
+        workers.emplace_back(&thread_pool::worker_loop,this);
+    }
+}
+
+thread_pool:: ~thread_pool() {
+
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+
+    work_available.notify_all();
+    for(auto &worker: workers) worker.join();
+}
+
+size_t thread_pool:: size() const {
+
+    return workers.size() + 1;
+}
+
+void thread_pool:: run_tasks(unique_lock<mutex> &guard) {
+    //called with the lock held, releases it while a task runs
+
+    while(next_index < task_count) {
+
+        size_t index = next_index++;
+        const function<void(size_t)> &current_task = *task;
+        guard.unlock();
+
+        exception_ptr error = NULL;
+        try {
+
+            current_task(index);
+        }
+        catch(...) {
+
+            error = current_exception();
+        }
+
+        guard.lock();
+        if(error != NULL && failure == NULL) failure = error;
+        if(++finished_count == task_count) work_finished.notify_all();
+    }
+}
+
+void thread_pool:: worker_loop() {
+
+    unsigned long seen_generation = 0;
+    unique_lock<mutex> guard(lock);
+
+    while(true) {
+
+        work_available.wait(guard,[&] { return stopping || generation != seen_generation; });
+        if(stopping) return;
+
+        seen_generation = generation;
+        run_tasks(guard);
+    }
+}
+
+void thread_pool:: parallel_for(size_t count, const function<void(size_t)> &task) {
+
+    if(count == 0) return;
+
+    unique_lock<mutex> guard(lock);
+    this->task = &task;
+    this->task_count = count;
+    this->next_index = 0;
+    this->finished_count = 0;
+    this->failure = NULL;
+    generation++;
+    work_available.notify_all();
+
+    run_tasks(guard);
+    work_finished.wait(guard,[&] { return finished_count == task_count; });
+
+    exception_ptr error = failure;
+    this->task = NULL;
+    this->task_count = 0;
+    this->next_index = 0;
+    guard.unlock();
+
+    if(error != NULL) rethrow_exception(error);
+}
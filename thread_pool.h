@@ -0,0 +1,44 @@
+//thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include<condition_variable>
+#include<exception>
+#include<functional>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+class thread_pool {
+
+    /* a fixed set of worker threads which run index based loops. parallel_for hands out the indices one at a time,
+     * the calling thread works along and returns once every index is done. The first exception thrown by a task is
+     * rethrown to the caller */
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable work_available;
+    std::condition_variable work_finished;
+
+    const std::function<void(size_t)>* task;
+    size_t task_count;
+    size_t next_index;
+    size_t finished_count;
+    unsigned long generation; //bumped for every parallel_for so that sleeping workers notice new work
+    bool stopping;
+    std::exception_ptr failure;
+
+    void worker_loop();
+    void run_tasks(std::unique_lock<std::mutex> &guard);
+
+    public:
+    thread_pool(size_t thread_count = std::thread::hardware_concurrency());
+    thread_pool(const thread_pool &) = delete;
+    thread_pool& operator=(const thread_pool &) = delete;
+    ~thread_pool();
+    void parallel_for(size_t count, const std::function<void(size_t)> &task);
+    size_t size() const; //threads taking part in a parallel_for, including the caller
+
+};
+
+#endif
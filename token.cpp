@@ -1,39 +1,31 @@
+
 #include<iostream>
 #include "token.h"
 
 using namespace tok;
 using namespace std;
 
-token:: token(){};
-token:: token(string &lexeme, token_type &type, int &line_number,double &literalvalue){
-
-        this->lexeme = lexeme;
-        this->type = type;
-        this->line_number = line_number;
-        this->int_literal_value = literalvalue;
-}
+token:: token(): offset(0), length(0), type(ERROR), line_number(0), literal_index(0) {};
+token:: token(uint32_t offset, uint32_t length, token_type type, int line_number, uint32_t literal_index): offset(offset), length(length), type(type), line_number(line_number), literal_index(literal_index) {};
 
-token:: token(string &lexeme, token_type &type, int &line_number,string &literalvalue){
 
-        this->lexeme = lexeme;
-        this->type = type;
-        this->line_number = line_number;
-        this->string_literal_value = literalvalue;
-}
-token:: token(string &lexeme, token_type &type, int &line_number){
+string_view token:: lexeme(const source_buffer &source) const {
 
-        this->lexeme = lexeme;
-        this->type = type;
-        this->line_number = line_number;
+    return source.view(offset,length);
 }
 
+string_view token:: string_literal_value(const source_buffer &source) const {
+    //the lexeme of a string literal includes both quotes
 
-void token:: print_token(){
-
-    std::cout<<lexeme;
+    return source.view(offset+1,length-2);
 }
 
+double token:: number_literal_value(const source_buffer &source) const {
 
+    return source.number_literals[literal_index];
+}
 
+void token:: print_token(const source_buffer &source) const {
 
-
+    std::cout<<lexeme(source);
+}
@@ -4,7 +4,10 @@
 #define TOKEN_H
 #include<string>
 #include<iostream>
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "source.h"
 
 namespace tok {
 typedef enum {
@@ -77,31 +80,69 @@ typedef enum {
 } token_type;
 
 
-const std:: unordered_map<token_type,std::string> enum_transalator = 
-                            {{LEFT_PAREN,"("},{COMMA,","},{RIGHT_PAREN,")"},{EQUAL,"="},{EQUAL_EQUAL,"=="},{VAR,"var"},{SEMICOLON,";"},{PLUS,"+"},{SLASH,"/"},{MINUS,"-"},
-                             {LEFT_BRACE,"{"},{RIGHT_BRACE,"}"},{DOT,"."},{STAR,"*"},{BANG,"!"},{BANG_EQUAL,"!="},{GREATER,">"},{GREATER_EQUAL,">="},{LESS,"<"},
-                             {LESS_EQUAL,"<="}, {AND,"and"},{CLASS,"class"},{IF,"if"},{NIL,"nil"},{OR,"or"},{PRINT,"print"},{RETURN,"return"},{SUPER,"super"},{THIS,"this"},
-                             {TRUE,"true"},{WHILE,"while"},{ELSE,"else"},{FALSE,"false"},{FUN,"fun"},{FOR,"for"},{TYPE,"type specifier"},{VOID_TYPE,"Void"},
-                             {COLON,":"},{INPUT_NUMBER,"input_number"}, {INPUT_STRING,"input_string"}};
+class token_spelling {
+
+    public:
+    std::string_view text;
+    token_type type;
+
+};
+
+/* every keyword, type name and operator of the language. The scanner's keyword hash, its operator tables and
+ * enum_transalator are all generated from this table at compile time */
+constexpr token_spelling token_spellings[] = {
+    {"(",LEFT_PAREN},{")",RIGHT_PAREN},{"{",LEFT_BRACE},{"}",RIGHT_BRACE},{",",COMMA},{".",DOT},{"-",MINUS},{"+",PLUS},{";",SEMICOLON},{":",COLON},
+    {"/",SLASH},{"*",STAR},{"!",BANG},{"!=",BANG_EQUAL},{"=",EQUAL},{"==",EQUAL_EQUAL},{">",GREATER},{">=",GREATER_EQUAL},{"<",LESS},{"<=",LESS_EQUAL},
+    {"and",AND},{"class",CLASS},{"else",ELSE},{"false",FALSE},{"fun",FUN},{"for",FOR},{"if",IF},{"nil",NIL},{"or",OR},{"print",PRINT},
+    {"return",RETURN},{"super",SUPER},{"this",THIS},{"true",TRUE},{"var",VAR},{"while",WHILE},{"String",TYPE},{"Number",TYPE},{"Void",VOID_TYPE},
+    {"input_number",INPUT_NUMBER},{"input_string",INPUT_STRING}
+};
+
+constexpr std::array<std::string_view,ERROR+1> build_enum_transalator() {
+    //the first spelling of a token type names it in error messages
+
+    std::array<std::string_view,ERROR+1> names{};
+    for(auto &spelling: token_spellings) {
+
+        if(names[spelling.type].empty()) names[spelling.type] = spelling.text;
+    }
+
+    names[TYPE] = "type specifier";
+    names[IDENTIFIER] = "identifier";
+    names[END_OF_FILE] = "end of file";
+    return names;
+}
+
+constexpr std::array<std::string_view,ERROR+1> enum_transalator = build_enum_transalator();
  
+const size_t max_token_offset = UINT32_MAX; //tokens start in the first 4 GiB of a source
+const size_t max_lexeme_length = (1 << 24) - 1; //what the 24 bits of token::length hold
+
 class token{
+    /* packed into 16 bytes. The lexeme is a view into the source buffer of the compilation unit,
+     * number literal values live in the source buffer's literal side table */
     public:
-    std::string lexeme;
-    token_type type;
+    uint32_t offset; //start of the lexeme in the source buffer
+    uint32_t length : 24;
+    token_type type : 8;
     int line_number;
-    std::string string_literal_value;
-    double int_literal_value;
-   
+    union {
+        uint32_t literal_index; //NUMBER_TYPE: index into source_buffer::number_literals
+        uint32_t symbol_id; //IDENTIFIER: id of the name in the string pool it was interned into
+    };
+
     token();
-    token(std::string &lexeme, token_type &type,int &line_number,std::string &literalvalue);
-    token(std::string &lexeme, token_type &type,int &line_number,double &literalvalue);
-    token(std::string &lexeme, token_type &type, int &line_number);
-    bool operator <(const token & tok2);
-    void print_token();
+    token(uint32_t offset, uint32_t length, token_type type, int line_number, uint32_t literal_index = 0);
+    std::string_view lexeme(const source_buffer &source) const;
+    std::string_view string_literal_value(const source_buffer &source) const;
+    double number_literal_value(const source_buffer &source) const;
+    void print_token(const source_buffer &source) const;
 
 };
 
 }
 
+static_assert(sizeof(tok::token) == 16, "tokens are expected to stay packed");
+
 #endif
 
@@ -0,0 +1,216 @@
+#include "value.h"
+#include <charconv>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+using namespace std;
+
+
+static_assert(sizeof(void*) == 8,"values keep heap pointers in the 48 bit payload of a NaN");
+static_assert(sizeof(value) == 8,"a value is one boxed double");
+
+const size_t short_string = 32; //concatenations up to this long are copied right away, a rope node would cost more
+const uint32_t max_rope_depth = 64; //no rope gets deeper, so the halves waiting to be flattened stay few
+
+string_object:: string_object(string text): flat(std::move(text)), length(flat.size()) {}
+
+string_object:: string_object(string_object* left, string_object* right): left(left), right(right), length(left->length + right->length), depth(max(left->depth,right->depth) + 1) {}
+
+void string_object:: flatten() {
+
+    //the bottom of the left spine gives up its buffer when every node down to it is only referred to by the one above
+    vector<string_object*> spine;
+    string_object* bottom = this;
+    bool unique = true;
+    while(bottom->depth != 0) {
+
+        spine.push_back(bottom);
+        bottom = bottom->left;
+        unique = unique && bottom->references == 1;
+    }
+
+    string text = unique ? std::move(bottom->flat) : bottom->flat;
+    if(text.capacity() < length) text.reserve(max(length,text.capacity() * 2));
+    vector<string_object*> pending;
+    for(auto node = spine.rbegin(); node != spine.rend(); node++) (*node)->right->append_to(text,pending);
+
+    flat = std::move(text);
+    for(string_object* half: {left,right}) if(--half->references == 0) destroy(half);
+    left = right = nullptr;
+    depth = 0;
+}
+
+void string_object:: append_to(string &text, vector<string_object*> &pending) {
+
+    pending.push_back(this);
+    while(!pending.empty()) {
+
+        string_object* node = pending.back();
+        pending.pop_back();
+        if(node->depth == 0) text += node->flat;
+        else {
+
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        }
+    }
+}
+
+size_t string_object:: hash() {
+
+    if(!hashed) {
+
+        hash_value = std::hash<string_view>()(text());
+        hashed = true;
+    }
+    return hash_value;
+}
+
+void string_object:: destroy(string_object* text) {
+    //iteratively, a rope built by appending in a loop is as deep as the loop was long
+
+    if(text->depth == 0) {
+
+        delete text;
+        return;
+    }
+
+    vector<string_object*> dying = {text};
+    while(!dying.empty()) {
+
+        string_object* node = dying.back();
+        dying.pop_back();
+        for(string_object* half: {node->left,node->right}) if(half != nullptr && --half->references == 0) dying.push_back(half);
+        delete node;
+    }
+}
+
+function_object:: function_object(callable function): function(function) {}
+
+value:: value(string text): bits(string_tag | reinterpret_cast<uint64_t>(static_cast<heap_object*>(new string_object(std::move(text))))) {}
+
+value:: value(string_object* text): bits(string_tag | reinterpret_cast<uint64_t>(static_cast<heap_object*>(text))) {}
+
+value:: value(callable function): bits(function_tag | reinterpret_cast<uint64_t>(static_cast<heap_object*>(new function_object(function)))) {}
+
+void value:: destroy() {
+
+    if((bits & tag_mask) == string_tag) string_object::destroy(text_object());
+    else delete static_cast<function_object*>(object());
+}
+
+value_kind value:: kind() const {
+
+    if(is_number()) return NUMBER_VALUE;
+    switch(bits & tag_mask) {
+
+        case string_tag: return STRING_VALUE;
+        case function_tag: return FUNCTION_VALUE;
+        default: return bits == nil_bits ? NIL_VALUE : BOOL_VALUE;
+    }
+}
+
+bool value:: equals(const value &other) const {
+
+    if(is_number() || other.is_number()) return is_number() && other.is_number() && number() == other.number();
+    value_kind own = kind();
+    if(own != other.kind()) return false;
+    switch(own) {
+
+        case STRING_VALUE: {
+
+            string_object *a = text_object(), *b = other.text_object();
+            if(a == b) return true;
+            if(a->length != b->length || (a->interned && b->interned)) return false;
+            return a->hash() == b->hash() && a->text() == b->text();
+        }
+        case FUNCTION_VALUE: return function().code == other.function().code && function().frame == other.function().frame;
+        default: return bits == other.bits;
+    }
+}
+
+const char* value:: kind_name() const {
+
+    switch(kind()) {
+
+        case NIL_VALUE: return "nil";
+        case BOOL_VALUE: return "Bool";
+        case NUMBER_VALUE: return "Number";
+        case STRING_VALUE: return "String";
+        default: return "Function";
+    }
+}
+
+ostream& operator<<(ostream &out, const value &v) {
+
+    switch(v.kind()) {
+
+        case NIL_VALUE: return out<<"nil";
+        case BOOL_VALUE: return out<<(v.boolean() ? "true" : "false");
+        case NUMBER_VALUE: {
+            /* whole numbers in full, anything else as the shortest text which reads back as the same double: 3 rather
+             * than 3.000000, 1000000 rather than 1e+06 and 0.1 rather than 0.10000000000000001 */
+
+            char digits[32];
+            double number = v.number();
+            bool whole = number > -1e15 && number < 1e15 && number == int64_t(number);
+            auto result = whole ? to_chars(digits,digits + sizeof(digits),int64_t(number)) : to_chars(digits,digits + sizeof(digits),number);
+            return out.write(digits,result.ptr - digits);
+        }
+        case STRING_VALUE: return out<<v.text();
+        default: return out<<"<function>";
+    }
+}
+
+bool parse_number(const string &line, double &number) {
+
+    char* end;
+    number = strtod(line.c_str(),&end);
+    if(number != number) number = numeric_limits<double>::quiet_NaN();
+    return end != line.c_str();
+}
+
+value concatenate(const value &left, const value &right) {
+
+    string_object *a = left.text_object(), *b = right.text_object();
+    if(a->length == 0) return right;
+    if(b->length == 0) return left;
+    if(a->length + b->length <= short_string) return value(a->text() + b->text());
+
+    //the deeper half is flattened in place, where its own spine is not shared any more, rather than the new node
+    if(max(a->depth,b->depth) >= max_rope_depth) (a->depth >= b->depth ? a : b)->text();
+    a->references++;
+    b->references++;
+    return value(new string_object(a,b));
+}
+
+string_table:: ~string_table() {
+
+    for(auto &entry: strings) if(--entry.second->references == 0) string_object::destroy(entry.second);
+}
+
+value string_table:: intern(string_view text) {
+
+    auto known = strings.find(text);
+    if(known == strings.end()) {
+
+        auto interned = new string_object(string(text));
+        interned->interned = true;
+        interned->hash();
+        known = strings.emplace(string_view(interned->text()),interned).first;
+    }
+    known->second->references++;
+    return value(known->second);
+}
+
+size_t string_table:: size() const {
+
+    return strings.size();
+}
+
+string_table& interned_strings() {
+
+    static thread_local string_table table;
+    return table;
+}
@@ -0,0 +1,165 @@
+//value.h
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+typedef enum : uint8_t {
+
+    NIL_VALUE,
+    BOOL_VALUE,
+    NUMBER_VALUE,
+    STRING_VALUE,
+    FUNCTION_VALUE
+
+} value_kind;
+
+class callable {
+
+    public:
+    const void* code; //what the engine runs: the function_declaration_statement for the interpreter, the compiled function for the VMs
+    uint32_t frame; //the frame the function was declared in, its body looks up the names around it there
+
+    /* an index stays valid because a function value can only be reached through the name it was declared with, which
+     * semantic_analyser does not let a program assign: the value goes away with the frame holding it */
+
+};
+
+/* calls may nest this deep in every engine before the program stops with a run time error. Deeper recursion is a
+ * missing base case far more often than a real workload, and would otherwise run until memory is exhausted */
+const uint32_t max_call_depth = 1 << 16;
+
+class heap_object {
+
+    //what a string or function value points at. A value never leaves the thread running its program, so the count is not atomic
+
+    public:
+    uint32_t references = 1;
+
+};
+
+class string_object: public heap_object {
+
+    /* an immutable string. A concatenation starts out as a rope node which only refers to its two halves, and is
+     * flattened the first time its characters are read. Flattening takes over the characters at the bottom of the
+     * left spine when nothing else can see them, so s = s + x in a loop appends to one buffer which grows
+     * geometrically, whether s is read in between or not */
+
+    std::string flat;
+    string_object* left = nullptr;
+    string_object* right = nullptr;
+    size_t hash_value = 0;
+    bool hashed = false;
+
+    void flatten();
+    void append_to(std::string &text, std::vector<string_object*> &pending); //the characters in order, without flattening
+
+    public:
+    size_t length;
+    uint32_t depth = 0; //of the rope below the node, 0 once it is flat
+    bool interned = false;
+
+    string_object(std::string text);
+    string_object(string_object* left, string_object* right); //takes over a reference to each half
+    const std::string& text() { if(depth != 0) flatten(); return flat; }
+    size_t hash();
+    static void destroy(string_object* text); //once nothing refers to it, along with the halves only it referred to
+
+};
+
+class function_object: public heap_object {
+
+    public:
+    callable function;
+    function_object(callable function);
+
+};
+
+class value {
+
+    /* what a frame slot holds at run time, in 8 bytes. A Number is its double. Everything else is a quiet NaN with bit
+     * 50 set, which no arithmetic on Numbers produces: nil and the booleans are small payloads, strings and functions
+     * have the sign bit set and a pointer to their reference counted heap object in the low 48 bits, with a tag in the
+     * two bits above it. So a type check is a mask and a compare, and copying anything but a string or a function
+     * touches no memory besides the 8 bytes. Comparisons and ! give the numbers 1 and 0, which is the type
+     * semantic_analyser infers for them, so nil, false and 0 are the false values */
+
+    static constexpr uint64_t boxed = 0x7ffc000000000000;
+    static constexpr uint64_t object_bits = 0x8000000000000000 | boxed;
+    static constexpr uint64_t tag_mask = 0xffff000000000000;
+    static constexpr uint64_t string_tag = object_bits | (1ull << 48);
+    static constexpr uint64_t function_tag = object_bits | (2ull << 48);
+    static constexpr uint64_t nil_bits = boxed | 1;
+    static constexpr uint64_t false_bits = boxed | 2;
+    static constexpr uint64_t true_bits = boxed | 3;
+
+    uint64_t bits;
+
+    bool is_object() const { return (bits & object_bits) == object_bits; }
+    heap_object* object() const { return reinterpret_cast<heap_object*>(bits & ~tag_mask); }
+    void retain() const { if(is_object()) object()->references++; }
+    void release() { if(is_object() && --object()->references == 0) destroy(); }
+    void destroy();
+
+    public:
+    value(): bits(nil_bits) {}
+    explicit value(double number) { memcpy(&bits,&number,sizeof(bits)); }
+    explicit value(bool boolean): bits(boolean ? true_bits : false_bits) {}
+    explicit value(std::string text);
+    explicit value(string_object* text); //takes over a reference
+    explicit value(callable function);
+
+    value(const value &other): bits(other.bits) { retain(); }
+    value(value &&other) noexcept: bits(other.bits) { other.bits = nil_bits; }
+    value& operator=(const value &other) { other.retain(); release(); bits = other.bits; return *this; }
+    value& operator=(value &&other) noexcept { uint64_t moved = other.bits; other.bits = nil_bits; release(); bits = moved; return *this; }
+    ~value() { release(); }
+
+    bool is_number() const { return (bits & boxed) != boxed; }
+    double number() const { double number; memcpy(&number,&bits,sizeof(number)); return number; }
+    bool boolean() const { return bits == true_bits; }
+    string_object* text_object() const { return static_cast<string_object*>(object()); }
+    const std::string& text() const { return text_object()->text(); }
+    const callable& function() const { return static_cast<function_object*>(object())->function; }
+
+    value_kind kind() const;
+    bool truthy() const { return is_number() ? number() != 0 : bits != nil_bits && bits != false_bits; }
+    bool equals(const value &other) const;
+    const char* kind_name() const;
+
+};
+
+std::ostream& operator<<(std::ostream &out, const value &v); //the way print shows a value
+
+value concatenate(const value &left, const value &right); //String +, a rope node unless the result is short
+
+class string_table {
+
+    /* interns the strings a program spells out, its literals and the names input statements report. Equal interned
+     * strings are one object with its hash computed once, so they compare by pointer */
+
+    std::unordered_map<std::string_view,string_object*> strings; //the keys view the objects' characters
+
+    public:
+    string_table() = default;
+    string_table(const string_table &) = delete;
+    string_table& operator=(const string_table &) = delete;
+    ~string_table();
+    value intern(std::string_view text);
+    size_t size() const;
+
+};
+
+string_table& interned_strings(); //one table per thread, as values never leave the thread that made them
+
+/* what input_number accepts: a line starting with a number. NaN payloads from "nan(...)" are dropped, so a number
+ * read in can never pass for a boxed value */
+bool parse_number(const std::string &line, double &number);
+
+#endif
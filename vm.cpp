@@ -0,0 +1,306 @@
+#include "vm.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+virtual_machine:: virtual_machine(const bytecode_program &program, ostream &out, istream &in): program(program), out(out), in(in) {}
+
+void virtual_machine:: run(bool threaded, bool counting) {
+
+    const compiled_function &top_level = program.functions[0];
+    stack.assign(max<size_t>(top_level.frame_size + top_level.max_stack,1 << 12),value());
+    frames.assign(1,call_frame{&top_level,top_level.code.data(),0,UINT32_MAX});
+
+    dispatches = 0;
+    if(counting) execute<false,true>();
+    else if(threaded && threaded_dispatch_available) execute<true,false>();
+    else execute<false,false>();
+    out.flush();
+}
+
+string virtual_machine:: runtime_error(const uint8_t* ip, const string &message) const {
+    //ip is past the opcode of the failing instruction, so one byte back is inside it
+
+    const compiled_function &function = *frames.back().function;
+    int line_number = function.line_of(ip - function.code.data() - 1);
+    return "RUNTIME ERROR at line " + to_string(line_number) + " : " + message;
+}
+
+value virtual_machine:: binary_fallback(opcode op, const value &left, const value &right, const uint8_t* ip) const {
+
+    if(op == OP_EQUAL) return value(double(left.equals(right)));
+    if(op == OP_NOT_EQUAL) return value(double(!left.equals(right)));
+
+    if(left.kind() == STRING_VALUE && right.kind() == STRING_VALUE) {
+
+        if(op == OP_ADD) return concatenate(left,right);
+        const string &a = left.text(), &b = right.text();
+        switch(op) {
+
+            case OP_LESS: return value(double(a < b));
+            case OP_LESS_EQUAL: return value(double(a <= b));
+            case OP_GREATER: return value(double(a > b));
+            case OP_GREATER_EQUAL: return value(double(a >= b));
+            default: break;
+        }
+    }
+
+    const char* operators[] = {"+","-","*","/","<","<=",">",">="};
+    throw runtime_error(ip,"Invalid operands " + string(left.kind_name()) + " and " + right.kind_name() + " to operator " + operators[op - OP_ADD]);
+}
+
+value virtual_machine:: read_input(opcode op, const uint8_t* ip) {
+
+    uint32_t name;
+    memcpy(&name,ip,4);
+    string line;
+    if(!getline(in,line)) throw runtime_error(ip,"no input left for \"" + program.constants[name].text() + "\"");
+    if(op == OP_INPUT_STRING) return value(std::move(line));
+
+    double number;
+    if(!parse_number(line,number)) throw runtime_error(ip,"\"" + line + "\" is not a number");
+    return value(number);
+}
+
+#if defined(__GNUC__) && defined(ALOX_SWITCH_DISPATCH)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-label" //the threaded labels, with no jump table to refer to them
+#endif
+template<bool threaded, bool counting>
+void virtual_machine:: execute() {
+    /* the running frame's code, slots and operand stack top live in locals of this function. They are written back
+     * into the frame only around calls and reloaded when the stack grows */
+
+#if defined(__GNUC__) && !defined(ALOX_SWITCH_DISPATCH)
+    static void* const jump_table[OP_COUNT] = {
+        &&op_constant, &&op_nil, &&op_true, &&op_false, &&op_pop,
+        &&op_get_local, &&op_set_local, &&op_store_local, &&op_get_global, &&op_set_global, &&op_store_global,
+        &&op_get_outer, &&op_set_outer, &&op_store_outer,
+        &&op_add, &&op_subtract, &&op_multiply, &&op_divide,
+        &&op_less, &&op_less_equal, &&op_greater, &&op_greater_equal, &&op_equal, &&op_not_equal,
+        &&op_negate, &&op_not, &&op_jump, &&op_jump_if_false, &&op_jump_if_false_or_pop, &&op_jump_if_true_or_pop,
+        &&op_closure, &&op_call, &&op_return, &&op_print, &&op_input_number, &&op_input_string
+    };
+#define NEXT_THREADED goto *jump_table[*ip++]
+#else
+#define NEXT_THREADED
+#endif
+#define DISPATCH() do { if constexpr (threaded) { NEXT_THREADED; } else { goto dispatch; } } while(0)
+#define READ_OPERAND() (memcpy(&operand,ip,4), ip += 4, operand)
+#define READ_OFFSET() do { memcpy(&offset,ip,4); ip += 4; } while(0) //into offset
+
+    call_frame* frame = &frames.back();
+    const uint8_t* ip = frame->ip;
+    const value* constants = program.constants.data();
+    value* globals = stack.data();
+    value* locals = globals + frame->base;
+    value* sp = locals + frame->function->frame_size;
+    uint32_t operand;
+    int32_t offset;
+
+    //the slots of the frame hops declaring frames out from the running one
+    auto outer_frame = [&](uint32_t hops) {
+
+        uint32_t index = frame->parent;
+        while(--hops > 0) index = frames[index].parent;
+        return stack.data() + frames[index].base;
+    };
+
+    if constexpr (threaded) NEXT_THREADED;
+
+    [[maybe_unused]] dispatch: //only the switch loop comes back here
+    if constexpr (counting) dispatches++;
+    switch(opcode(*ip++)) {
+
+        case OP_CONSTANT: op_constant:
+            *sp++ = constants[READ_OPERAND()];
+            DISPATCH();
+
+        case OP_NIL: op_nil:
+            *sp++ = value();
+            DISPATCH();
+
+        case OP_TRUE: op_true:
+            *sp++ = value(true);
+            DISPATCH();
+
+        case OP_FALSE: op_false:
+            *sp++ = value(false);
+            DISPATCH();
+
+        case OP_POP: op_pop:
+            sp--;
+            DISPATCH();
+
+        case OP_GET_LOCAL: op_get_local:
+            *sp++ = locals[READ_OPERAND()];
+            DISPATCH();
+
+        case OP_SET_LOCAL: op_set_local:
+            locals[READ_OPERAND()] = sp[-1];
+            DISPATCH();
+
+        case OP_STORE_LOCAL: op_store_local:
+            locals[READ_OPERAND()] = std::move(*--sp);
+            DISPATCH();
+
+        case OP_GET_GLOBAL: op_get_global:
+            *sp++ = globals[READ_OPERAND()];
+            DISPATCH();
+
+        case OP_SET_GLOBAL: op_set_global:
+            globals[READ_OPERAND()] = sp[-1];
+            DISPATCH();
+
+        case OP_STORE_GLOBAL: op_store_global:
+            globals[READ_OPERAND()] = std::move(*--sp);
+            DISPATCH();
+
+        case OP_GET_OUTER: op_get_outer: {
+
+            value* slots = outer_frame(READ_OPERAND());
+            *sp++ = slots[READ_OPERAND()];
+            DISPATCH();
+        }
+
+        case OP_SET_OUTER: op_set_outer: {
+
+            value* slots = outer_frame(READ_OPERAND());
+            slots[READ_OPERAND()] = sp[-1];
+            DISPATCH();
+        }
+
+        case OP_STORE_OUTER: op_store_outer: {
+
+            value* slots = outer_frame(READ_OPERAND());
+            slots[READ_OPERAND()] = std::move(*--sp);
+            DISPATCH();
+        }
+
+#define NUMBER_OPERATION(op, label, result) \
+        case op: label: { \
+            value &left = sp[-2], &right = sp[-1]; \
+            if(left.is_number() && right.is_number()) left = value(double(result)); \
+            else left = binary_fallback(op,left,right,ip); \
+            sp--; \
+            DISPATCH(); \
+        }
+
+        NUMBER_OPERATION(OP_ADD,op_add,left.number() + right.number())
+        NUMBER_OPERATION(OP_SUBTRACT,op_subtract,left.number() - right.number())
+        NUMBER_OPERATION(OP_MULTIPLY,op_multiply,left.number() * right.number())
+        NUMBER_OPERATION(OP_DIVIDE,op_divide,left.number() / right.number())
+        NUMBER_OPERATION(OP_LESS,op_less,left.number() < right.number())
+        NUMBER_OPERATION(OP_LESS_EQUAL,op_less_equal,left.number() <= right.number())
+        NUMBER_OPERATION(OP_GREATER,op_greater,left.number() > right.number())
+        NUMBER_OPERATION(OP_GREATER_EQUAL,op_greater_equal,left.number() >= right.number())
+        NUMBER_OPERATION(OP_EQUAL,op_equal,left.number() == right.number())
+        NUMBER_OPERATION(OP_NOT_EQUAL,op_not_equal,left.number() != right.number())
+#undef NUMBER_OPERATION
+
+        case OP_NEGATE: op_negate:
+            if(!sp[-1].is_number()) throw runtime_error(ip,"Invalid operand " + string(sp[-1].kind_name()) + " to operator -");
+            sp[-1] = value(-sp[-1].number());
+            DISPATCH();
+
+        case OP_NOT: op_not:
+            sp[-1] = value(double(!sp[-1].truthy()));
+            DISPATCH();
+
+        case OP_JUMP: op_jump:
+            READ_OFFSET();
+            ip += offset;
+            DISPATCH();
+
+        case OP_JUMP_IF_FALSE: op_jump_if_false:
+            READ_OFFSET();
+            sp--;
+            if(!sp->truthy()) ip += offset;
+            DISPATCH();
+
+        case OP_JUMP_IF_FALSE_OR_POP: op_jump_if_false_or_pop:
+            READ_OFFSET();
+            if(!sp[-1].truthy()) ip += offset;
+            else sp--;
+            DISPATCH();
+
+        case OP_JUMP_IF_TRUE_OR_POP: op_jump_if_true_or_pop:
+            READ_OFFSET();
+            if(sp[-1].truthy()) ip += offset;
+            else sp--;
+            DISPATCH();
+
+        case OP_CLOSURE: op_closure:
+            //semantic_analyser does not let a function value be assigned, so it never outlives the running frame
+            *sp++ = value(callable{&program.functions[READ_OPERAND()],uint32_t(frames.size() - 1)});
+            DISPATCH();
+
+        case OP_CALL: op_call: {
+
+            uint32_t argument_count = READ_OPERAND();
+            const value &callee = sp[-int32_t(argument_count) - 1];
+            if(callee.kind() != FUNCTION_VALUE) throw runtime_error(ip,string(callee.kind_name()) + " is not a function");
+            auto function = static_cast<const compiled_function*>(callee.function().code);
+            uint32_t parent = callee.function().frame;
+            if(frames.size() > max_call_depth) throw runtime_error(ip,"Stack overflow, calls nest deeper than " + to_string(max_call_depth));
+
+            //the arguments stay where they are and become the parameters
+            uint32_t base = sp - stack.data() - argument_count;
+            size_t needed = size_t(base) + function->frame_size + function->max_stack;
+            if(needed > stack.size()) {
+
+                stack.resize(max(needed,stack.size() * 2));
+                globals = stack.data();
+            }
+
+            frame->ip = ip;
+            frames.push_back(call_frame{function,function->code.data(),base,parent});
+            frame = &frames.back();
+            ip = frame->ip;
+            locals = stack.data() + base;
+            sp = locals + function->frame_size;
+            DISPATCH();
+        }
+
+        case OP_RETURN: op_return: {
+
+            value result = std::move(sp[-1]);
+            uint32_t base = frame->base;
+            frames.pop_back();
+            if(frames.empty()) return;
+
+            frame = &frames.back();
+            ip = frame->ip;
+            locals = stack.data() + frame->base;
+            sp = stack.data() + base - 1; //over the callee
+            *sp++ = std::move(result);
+            DISPATCH();
+        }
+
+        case OP_PRINT: op_print:
+            out<<*--sp<<'\n';
+            DISPATCH();
+
+        case OP_INPUT_NUMBER: op_input_number:
+            *sp++ = read_input(OP_INPUT_NUMBER,ip);
+            ip += 4;
+            DISPATCH();
+
+        case OP_INPUT_STRING: op_input_string:
+            *sp++ = read_input(OP_INPUT_STRING,ip);
+            ip += 4;
+            DISPATCH();
+
+        default: throw runtime_error(ip,"unknown opcode");
+    }
+
+#undef NEXT_THREADED
+#undef DISPATCH
+#undef READ_OPERAND
+#undef READ_OFFSET
+}
+#if defined(__GNUC__) && defined(ALOX_SWITCH_DISPATCH)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,55 @@
+//vm.h
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bytecode.h"
+#include "value.h"
+
+#if defined(__GNUC__) && !defined(ALOX_SWITCH_DISPATCH)
+const bool threaded_dispatch_available = true; //labels as values, GCC and clang
+#else
+const bool threaded_dispatch_available = false;
+#endif
+
+class call_frame {
+
+    public:
+    const compiled_function* function;
+    const uint8_t* ip; //where the function continues once its callee returns
+    uint32_t base; //index of slot 0 of the frame on the value stack
+    uint32_t parent; //the frame the function was declared in, for OP_GET_OUTER
+
+};
+
+class virtual_machine {
+
+    /* runs a bytecode_program on one value stack. A frame is its function's frame_size slots with the operand stack
+     * right above them; a call turns the arguments already on the stack into the first slots of the callee's frame,
+     * so calls and returns copy nothing but the result. Threaded dispatch jumps from the end of every instruction
+     * straight to the next one through a table of label addresses, the switch dispatch goes back to one switch.
+     * Run time errors are thrown as strings, like the interpreter's */
+
+    const bytecode_program &program;
+    std::ostream &out;
+    std::istream &in;
+    std::vector<value> stack;
+    std::vector<call_frame> frames;
+
+    template<bool threaded, bool counting> void execute();
+    std::string runtime_error(const uint8_t* ip, const std::string &message) const;
+    value binary_fallback(opcode op, const value &left, const value &right, const uint8_t* ip) const; //strings, mixed kinds, errors
+    value read_input(opcode op, const uint8_t* ip);
+
+    public:
+    uint64_t dispatches = 0; //instructions the last counting run went through
+
+    virtual_machine(const bytecode_program &program, std::ostream &out = std::cout, std::istream &in = std::cin);
+    void run(bool threaded = threaded_dispatch_available, bool counting = false); //counting runs on the switch
+
+};
+
+#endif